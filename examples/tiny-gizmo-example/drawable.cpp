@@ -1,5 +1,8 @@
 #include "drawable.h"
-#include <unordered_map>
+#include <raylib/external/glad.h>
+#include <algorithm>
+#include <string.h>
+#include <vector>
 
 inline Matrix TRS(const Vector3 &t, const Quaternion &r, const Vector3 &s) {
   return MatrixMultiply(
@@ -7,65 +10,272 @@ inline Matrix TRS(const Vector3 &t, const Quaternion &r, const Vector3 &s) {
       MatrixTranslate(t.x, t.y, t.z));
 }
 
-void Drawable::load(std::span<const Vertex> vertices,
-                    std::span<const uint32_t> indices, bool dynamic) {
+// splitmix64 finalizer
+static uint64_t mix(uint64_t h) {
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  return h ^ (h >> 31);
+}
+
+// the colors as they are uploaded
+static Color to_color(const Vector3 &color) {
+  return {
+      static_cast<unsigned char>(std::max(0.0f, color.x) * 255),
+      static_cast<unsigned char>(std::max(0.0f, color.y) * 255),
+      static_cast<unsigned char>(std::max(0.0f, color.z) * 255),
+      255,
+  };
+}
+
+static uint64_t hash_bytes(const void *data, size_t size, uint64_t h) {
+  auto p = static_cast<const unsigned char *>(data);
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t word;
+    memcpy(&word, p, 8);
+    h = (h ^ mix(word)) * 0x100000001b3ull;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, p, size);
+  return mix(h ^ tail ^ size);
+}
+
+Model MeshCache::load(std::span<const Vertex> vertices,
+                      std::span<const uint32_t> indices) {
+  auto hash = hash_bytes(vertices.data(), vertices.size_bytes(),
+                         mix(vertices.size() ^ mix(indices.size())));
+  hash = hash_bytes(indices.data(), indices.size_bytes(), hash);
+  // a hash collision is a miss
+  auto [begin, end] = _models.equal_range(hash);
+  for (auto it = begin; it != end; ++it) {
+    if (same_content(it->second, vertices, indices)) {
+      return it->second.model;
+    }
+  }
 
-  // vertices
+  // UnloadMesh frees these
   auto mesh_vertices = (Vector3 *)MemAlloc(vertices.size() * sizeof(Vector3));
-  // mesh.normals = (float *)MemAlloc(mesh.vertexCount * 3 * sizeof(float));
   auto mesh_colors = (Color *)MemAlloc(vertices.size() * sizeof(Color));
-  auto pos = 0;
-  // auto nom = 0;
-  auto col = 0;
-  for (auto &v : vertices) {
-    mesh_vertices[pos++] = {
-        v.position.x,
-        v.position.y,
-        v.position.z,
-    };
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto &v = vertices[i];
+    mesh_vertices[i] = {v.position.x, v.position.y, v.position.z};
+    mesh_colors[i] = to_color(v.color);
+  }
+  Mesh mesh = {
+      .vertexCount = static_cast<int>(vertices.size()),
+      .triangleCount = static_cast<int>(indices.size() / 3),
+      .vertices = &mesh_vertices[0].x,
+      .colors = &mesh_colors[0].r,
+  };
+
+  const bool wide = vertices.size() > 0x10000;
+  if (!wide) {
+    mesh.indices =
+        (unsigned short *)MemAlloc(indices.size() * sizeof(unsigned short));
+    std::copy(indices.begin(), indices.end(), mesh.indices);
+  }
+  UploadMesh(&mesh, false);
+  if (wide) {
+    // UploadMesh only knows 16 bit indices. the element buffer binding
+    // belongs to the vao
+    rlEnableVertexArray(mesh.vaoId);
+    mesh.vboId[6] = rlLoadVertexBufferElement(
+        indices.data(), static_cast<int>(indices.size_bytes()), false);
+    rlDisableVertexArray();
+  }
 
-    // mesh.normals[nom++] = v.normal.x;
-    // mesh.normals[nom++] = v.normal.y;
-    // mesh.normals[nom++] = v.normal.z;
+  auto model = LoadModelFromMesh(mesh);
+  _models.emplace(hash,
+                  Entry{model, std::vector(indices.begin(), indices.end())});
+  return model;
+}
 
-    mesh_colors[col++] = {
-        static_cast<unsigned char>(std::max(0.0f, v.color.x) * 255),
-        static_cast<unsigned char>(std::max(0.0f, v.color.y) * 255),
-        static_cast<unsigned char>(std::max(0.0f, v.color.z) * 255),
-        255,
-    };
+bool MeshCache::same_content(const Entry &entry,
+                             std::span<const Vertex> vertices,
+                             std::span<const uint32_t> indices) {
+  // UploadMesh keeps the vertices and colors on the cpu
+  auto &mesh = entry.model.meshes[0];
+  if (size_t(mesh.vertexCount) != vertices.size() ||
+      !std::equal(indices.begin(), indices.end(), entry.indices.begin(),
+                  entry.indices.end())) {
+    return false;
+  }
+  auto positions = reinterpret_cast<const Vector3 *>(mesh.vertices);
+  auto colors = reinterpret_cast<const Color *>(mesh.colors);
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto &p = vertices[i].position;
+    auto c = to_color(vertices[i].color);
+    if (positions[i].x != p.x || positions[i].y != p.y ||
+        positions[i].z != p.z || colors[i].r != c.r || colors[i].g != c.g ||
+        colors[i].b != c.b) {
+      return false;
+    }
   }
+  return true;
+}
 
-  auto mesh_indices =
-      (unsigned short *)MemAlloc(indices.size() * sizeof(unsigned short));
-  auto index = 0;
-  for (auto &i : indices) {
-    mesh_indices[index++] = i;
+void MeshCache::unload() {
+  for (auto &[hash, entry] : _models) {
+    UnloadModel(entry.model);
   }
+  _models.clear();
+}
 
-  load(vertices.size(), mesh_vertices, mesh_colors, indices.size(),
-       mesh_indices, dynamic);
+void Drawable::load(MeshCache &cache, std::span<const Vertex> vertices,
+                    std::span<const uint32_t> indices) {
+  this->model = cache.load(vertices, indices);
 }
 
-void Drawable::load(size_t vertexCount, const Vector3 *vertices,
-                    const Color *colors, size_t indexCount,
-                    const unsigned short *indices, bool dynamic) {
-  // Upload mesh data from CPU (RAM) to GPU (VRAM) memory
-  Mesh mesh = {
-      .vertexCount = static_cast<int>(vertexCount),
-      .triangleCount = static_cast<int>(indexCount / 3),
-      .vertices = const_cast<float *>(&vertices[0].x),
-      .colors = const_cast<unsigned char *>(&colors[0].r),
-      .indices = const_cast<unsigned short *>(indices),
-  };
-  UploadMesh(&mesh, dynamic);
-  this->model = LoadModelFromMesh(mesh);
+void Shape::build(std::span<const Vertex> vertices,
+                  std::span<const uint32_t> indices) {
+  std::vector<tinygizmo::Float3> positions;
+  std::vector<tinygizmo::Vertex> triangle_vertices;
+  positions.reserve(vertices.size());
+  triangle_vertices.reserve(vertices.size());
+  for (auto &v : vertices) {
+    positions.push_back({v.position.x, v.position.y, v.position.z});
+    triangle_vertices.push_back({.position = positions.back()});
+  }
+  this->snap_index.build(positions, indices);
+
+  std::vector<tinygizmo::UInt3> triangles;
+  triangles.reserve(indices.size() / 3);
+  for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+    triangles.push_back({indices[i], indices[i + 1], indices[i + 2]});
+  }
+  this->triangles.build(triangle_vertices, triangles);
+}
+
+// DrawMesh for 32 bit indices, which rlgl does not draw
+static void draw_wide_mesh(const Mesh &mesh, const Material &material,
+                           const Matrix &transform) {
+  auto &map = material.maps[MATERIAL_MAP_DIFFUSE];
+  auto locs = material.shader.locs;
+  rlEnableShader(material.shader.id);
+  float color[4] = {map.color.r / 255.0f, map.color.g / 255.0f,
+                    map.color.b / 255.0f, map.color.a / 255.0f};
+  rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], color, SHADER_UNIFORM_VEC4, 1);
+  auto mvp = MatrixMultiply(
+      MatrixMultiply(MatrixMultiply(transform, rlGetMatrixTransform()),
+                     rlGetMatrixModelview()),
+      rlGetMatrixProjection());
+  rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MVP], mvp);
+  int slot = 0;
+  rlActiveTextureSlot(slot);
+  rlEnableTexture(map.texture.id);
+  rlSetUniform(locs[SHADER_LOC_MAP_DIFFUSE], &slot, SHADER_UNIFORM_INT, 1);
+
+  rlEnableVertexArray(mesh.vaoId);
+  glDrawElements(GL_TRIANGLES, mesh.triangleCount * 3, GL_UNSIGNED_INT,
+                 nullptr);
+  rlDisableVertexArray();
+  rlDisableTexture();
+  rlDisableShader();
 }
 
-void Drawable::draw() {
+void draw_model(const Model &model, const tinygizmo::Transform &transform) {
   rlPushMatrix();
-  auto m = this->transform.matrix();
+  auto m = transform.matrix();
   rlMultMatrixf(&m.m00);
-  DrawModel(this->model, {0, 0, 0}, 1.0f, WHITE);
+  for (int i = 0; i < model.meshCount; ++i) {
+    auto &mesh = model.meshes[i];
+    auto &material = model.materials[model.meshMaterial[i]];
+    if (has_wide_indices(mesh)) {
+      // DrawMesh would take it for a mesh without indices
+      draw_wide_mesh(mesh, material, model.transform);
+    } else {
+      DrawMesh(mesh, material, model.transform);
+    }
+  }
   rlPopMatrix();
 }
+
+void Drawable::draw() { draw_model(this->model, this->transform); }
+
+void DynamicMesh::reserve(Buffer &buffer, size_t vertexCount,
+                          size_t indexCount) {
+  if (vertexCount <= buffer.vertex_capacity &&
+      indexCount <= buffer.index_capacity) {
+    return;
+  }
+  if (buffer.mesh.vaoId) {
+    UnloadMesh(buffer.mesh);
+  }
+  buffer.vertex_capacity = std::max(vertexCount, buffer.vertex_capacity * 2);
+  buffer.index_capacity = std::max(indexCount, buffer.index_capacity * 2);
+  // UploadMesh sizes the buffers from these. UnloadMesh frees them
+  buffer.mesh = {
+      .vertexCount = static_cast<int>(buffer.vertex_capacity),
+      .triangleCount = static_cast<int>(buffer.index_capacity / 3),
+      .vertices = (float *)MemAlloc(buffer.vertex_capacity * sizeof(Vector3)),
+      .colors = (unsigned char *)MemAlloc(buffer.vertex_capacity *
+                                          sizeof(Color)),
+  };
+  UploadMesh(&buffer.mesh, true);
+  // UploadMesh only knows 16 bit indices. the element buffer binding belongs
+  // to the vao
+  rlEnableVertexArray(buffer.mesh.vaoId);
+  buffer.mesh.vboId[6] = rlLoadVertexBufferElement(
+      nullptr, static_cast<int>(buffer.index_capacity * sizeof(uint32_t)),
+      true);
+  rlDisableVertexArray();
+}
+
+void DynamicMesh::update(size_t vertexCount, const Vector3 *vertices,
+                         const Color *colors, size_t indexCount,
+                         const uint32_t *indices) {
+  _current = (_current + 1) % RING;
+  _index_count = indexCount;
+  if (!vertexCount || !indexCount) {
+    return;
+  }
+  auto &buffer = _ring[_current];
+  reserve(buffer, vertexCount, indexCount);
+  auto &mesh = buffer.mesh;
+  UpdateMeshBuffer(mesh, 0, vertices, vertexCount * sizeof(Vector3), 0);
+  UpdateMeshBuffer(mesh, 3, colors, vertexCount * sizeof(Color), 0);
+  // the element buffer binding belongs to the vao
+  rlEnableVertexArray(mesh.vaoId);
+  rlUpdateVertexBufferElements(mesh.vboId[6], indices,
+                               indexCount * sizeof(uint32_t), 0);
+  rlDisableVertexArray();
+}
+
+void DynamicMesh::draw() {
+  if (!_index_count) {
+    return;
+  }
+  // DrawMesh with the default material, for 32 bit indices
+  auto &mesh = _ring[_current].mesh;
+  auto locs = rlGetShaderLocsDefault();
+  rlEnableShader(rlGetShaderIdDefault());
+  float color[4] = {1, 1, 1, 1};
+  rlSetUniform(locs[SHADER_LOC_COLOR_DIFFUSE], color, SHADER_UNIFORM_VEC4, 1);
+  // the vertices are in world space
+  auto mvp = MatrixMultiply(
+      MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview()),
+      rlGetMatrixProjection());
+  rlSetUniformMatrix(locs[SHADER_LOC_MATRIX_MVP], mvp);
+  int slot = 0;
+  rlActiveTextureSlot(slot);
+  rlEnableTexture(rlGetTextureIdDefault());
+  rlSetUniform(locs[SHADER_LOC_MAP_DIFFUSE], &slot, SHADER_UNIFORM_INT, 1);
+
+  rlEnableVertexArray(mesh.vaoId);
+  glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(_index_count),
+                 GL_UNSIGNED_INT, nullptr);
+  rlDisableVertexArray();
+  rlDisableTexture();
+  rlDisableShader();
+}
+
+void DynamicMesh::unload() {
+  for (auto &buffer : _ring) {
+    if (buffer.mesh.vaoId) {
+      UnloadMesh(buffer.mesh);
+    }
+    buffer = {};
+  }
+  _index_count = 0;
+}
@@ -1,16 +1,65 @@
 #pragma once
-#include "tinygizmo_alg.h"
+#include "tinygizmo.h"
+#include "tinygizmo_raycast.h"
+#include <array>
 #include <raylib.h>
 #include <raymath.h>
+#include <memory>
 #include <rlgl.h>
 #include <span>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 struct Vertex {
   Vector3 position;
   Vector3 color;
 };
 
+// the local space mesh on the cpu, for snapping and picking. shared by the
+// drawables of the same mesh
+struct Shape {
+  tinygizmo::SnapIndex snap_index;
+  tinygizmo::TriangleCache triangles;
+
+  void build(std::span<const Vertex> vertices,
+             std::span<const uint32_t> indices);
+};
+
+// draws the model under the transform, the meshes with 32 bit indices too
+void draw_model(const Model &model, const tinygizmo::Transform &transform);
+
+// A mesh of more than 65536 vertices. Its 32 bit indices are in vboId[6]
+// and mesh.indices is null, so DrawMesh does not know them. draw_model and
+// the InstancedRenderer draw them
+inline bool has_wide_indices(const Mesh &mesh) {
+  return !mesh.indices && mesh.vboId && mesh.vboId[6];
+}
+
+// Uploads each distinct vertex and index content once. load() of the same
+// data again returns the same Model, which the cache owns until unload().
+// The key is a 64 bit hash of the content. A hit is checked against the
+// content, so a collision only costs a second upload.
+class MeshCache {
+  struct Entry {
+    Model model;
+    // the mesh keeps its vertices, but not 32 bit indices
+    std::vector<uint32_t> indices;
+  };
+  std::unordered_multimap<uint64_t, Entry> _models;
+
+  static bool same_content(const Entry &entry,
+                           std::span<const Vertex> vertices,
+                           std::span<const uint32_t> indices);
+
+public:
+  Model load(std::span<const Vertex> vertices,
+             std::span<const uint32_t> indices);
+  size_t size() const { return _models.size(); }
+  // before CloseWindow
+  void unload();
+};
+
 struct Drawable {
   std::string name;
   Model model = {};
@@ -19,13 +68,38 @@ struct Drawable {
       .position = {0, 0, 0},
       .scale = {1, 1, 1},
   };
+  std::shared_ptr<const Shape> shape;
 
-  // Generate a simple triangle mesh from code
-  void load(std::span<const Vertex> vertices, std::span<const uint32_t> indices,
-            bool dynamic);
+  // Generate a simple triangle mesh from code. shares the mesh with the
+  // earlier loads of the same data
+  void load(MeshCache &cache, std::span<const Vertex> vertices,
+            std::span<const uint32_t> indices);
+
+  void draw();
+};
+
+// The gizmo mesh, rewritten every frame in world space. The buffers are
+// allocated once and updated in place, and grow by doubling. The frames
+// rotate through RING of them, so that a write does not wait for the draw
+// of the frame before. The indices are 32 bit, as one gizmo per selected
+// drawable soon passes what 16 bit indices address.
+class DynamicMesh {
+  static constexpr size_t RING = 3;
+  struct Buffer {
+    Mesh mesh = {};
+    size_t vertex_capacity = 0;
+    size_t index_capacity = 0;
+  };
+  std::array<Buffer, RING> _ring;
+  size_t _current = 0;
+  size_t _index_count = 0;
 
-  void load(size_t vertexCount, const Vector3 *vertices, const Color *colors,
-            size_t indexCount, const unsigned short *indices, bool dynamic);
+  void reserve(Buffer &buffer, size_t vertexCount, size_t indexCount);
 
+public:
+  void update(size_t vertexCount, const Vector3 *vertices, const Color *colors,
+              size_t indexCount, const uint32_t *indices);
   void draw();
+  // before CloseWindow
+  void unload();
 };
@@ -1,63 +1,91 @@
 #include "gizmo_dragger.h"
+#include <algorithm>
 #include <assert.h>
 #include <iostream>
+#include <numbers>
+
+// the increments of the snap hotkey
+static const float SNAP_TRANSLATION = 0.5f;
+static const float SNAP_ROTATION = std::numbers::pi_v<float> / 12;
+static const float SNAP_SCALE = 0.25f;
+// how far a translation reaches for a scene vertex or surface
+static const float SNAP_RADIUS = 0.25f;
+
+void TRSGizmo::select(std::optional<DrawableHandle> handle, bool additive) {
+  if (!additive) {
+    _selection.clear();
+  }
+  if (!handle) {
+    return;
+  }
+  auto found = std::find(_selection.begin(), _selection.end(), *handle);
+  if (found != _selection.end()) {
+    _selection.erase(found);
+  } else {
+    _selection.push_back(*handle);
+  }
+}
 
 void TRSGizmo::begin(const Vector2 &cursor) {
-  float best_t = std::numeric_limits<float>::infinity();
-  for (auto &target : this->_scene) {
-    //
-    // ray intersection
-    //
-    switch (this->_visible) {
-    case GizmoMode::Translation: {
-      auto intersection = tinygizmo::TranslationGizmo::intersect(
-          _current_state, _local_toggle, target->transform);
-      if (intersection) {
-        auto [ray_state, active_component] = *intersection;
-        if (ray_state.t < best_t) {
-          best_t = ray_state.t;
-          this->_t = active_component;
-          this->_gizmo_target = target;
-          this->_ray_state = ray_state;
-        }
-      }
-      break;
-    }
+  // forget the removed ones
+  std::erase_if(_selection,
+                [this](auto handle) { return !_scene->index(handle); });
+  _targets = _selection;
+  _transforms.clear();
+  for (auto handle : _targets) {
+    _transforms.push_back(_scene->transforms()[*_scene->index(handle)]);
+  }
 
-    case GizmoMode::Rotation: {
-      auto intersection = tinygizmo::RotationGizmo::intersect(
-          _current_state, _local_toggle, target->transform);
-      if (intersection) {
-        auto [ray_state, active_component] = *intersection;
-        if (ray_state.t < best_t) {
-          best_t = ray_state.t;
-          this->_r = active_component;
-          this->_gizmo_target = target;
-          this->_ray_state = ray_state;
-        }
-      }
-      break;
+  //
+  // ray intersection
+  //
+  switch (this->_visible) {
+  case GizmoMode::Translation:
+    if (auto intersection = tinygizmo::TranslationGizmo::intersect_many(
+            _current_state, _local_toggle, _transforms)) {
+      auto [ray_state, active_component, index] = *intersection;
+      this->_t = active_component;
+      this->_gizmo_target = _targets[index];
+      this->_ray_state = ray_state;
     }
+    break;
 
-    case GizmoMode::Scaling: {
-      auto intersection = tinygizmo::ScalingGizmo::intersect(
-          _current_state, _local_toggle, target->transform, _uniform);
-      if (intersection) {
-        auto [ray_state, active_component] = *intersection;
-        if (ray_state.t < best_t) {
-          best_t = ray_state.t;
-          this->_s = active_component;
-          this->_gizmo_target = target;
-          this->_ray_state = ray_state;
-        }
-      }
-      break;
+  case GizmoMode::Rotation:
+    if (auto intersection = tinygizmo::RotationGizmo::intersect_many(
+            _current_state, _local_toggle, _transforms)) {
+      auto [ray_state, active_component, index] = *intersection;
+      this->_r = active_component;
+      this->_gizmo_target = _targets[index];
+      this->_ray_state = ray_state;
     }
+    break;
 
-    default:
-      assert(false);
-      throw std::runtime_error("unknown gizmo mode");
+  case GizmoMode::Scaling:
+    if (auto intersection = tinygizmo::ScalingGizmo::intersect_many(
+            _current_state, _local_toggle, _transforms, _uniform)) {
+      auto [ray_state, active_component, index] = *intersection;
+      this->_s = active_component;
+      this->_gizmo_target = _targets[index];
+      this->_ray_state = ray_state;
     }
+    break;
+
+  default:
+    assert(false);
+    throw std::runtime_error("unknown gizmo mode");
+  }
+
+  if (!_gizmo_target) {
+    // not on a gizmo. select the drawable under the cursor, ctrl adds
+    auto hit = _scene->raycast(_current_state.ray);
+    select(hit ? std::optional(std::get<0>(*hit)) : std::nullopt,
+           _current_hotkey.hotkey_ctrl);
+    return;
+  }
+
+  if (_group) {
+    _group_drag.begin(_transforms,
+                      _scene->transforms()[*_scene->index(*_gizmo_target)]);
   }
 }
 
@@ -71,32 +99,79 @@ void TRSGizmo::end(const Vector2 &cursor) {
 
 void TRSGizmo::drag(const DragState &state, int w, int h,
                     const Vector2 &cursor) {
-  if (auto target = _gizmo_target) {
+  auto target = _gizmo_target ? _scene->index(*_gizmo_target) : std::nullopt;
+  if (target) {
+    auto transforms = _scene->transforms();
+    // in group mode the members move around the active one. drag it from
+    // where it was at begin() so that it does not feed back
+    auto &src = _group ? _group_drag.active : transforms[*target];
+    auto dst = src;
     switch (_visible) {
     case GizmoMode::Translation:
       if (_t) {
-        target->transform = tinygizmo::TranslationGizmo::drag(
-            *_t, _current_state, _ray_state, target->transform);
+        dst = tinygizmo::TranslationGizmo::drag(*_t, _current_state,
+                                                _ray_state, src);
+        // in group mode the rest of the selection moves along
+        if (_snap_target != SnapTarget::None && !_group) {
+          dst.position = snap_to_scene(dst.position, *_gizmo_target);
+        }
       }
       break;
     case GizmoMode::Rotation:
       if (_r) {
-        target->transform = tinygizmo::RotationGizmo::drag(
-            *_r, _current_state, _ray_state, target->transform);
+        dst = tinygizmo::RotationGizmo::drag(*_r, _current_state, _ray_state,
+                                             src);
       }
       break;
     case GizmoMode::Scaling:
       if (_s) {
-        target->transform = tinygizmo::ScalingGizmo::drag(
-            *_s, _current_state, _ray_state, target->transform);
+        dst = tinygizmo::ScalingGizmo::drag(*_s, _current_state, _ray_state,
+                                            src);
       }
       break;
     }
+
+    if (_group) {
+      _group_drag.apply(dst, _transforms);
+      for (size_t i = 0; i < _targets.size(); ++i) {
+        if (auto index = _scene->index(_targets[i])) {
+          transforms[*index] = _transforms[i];
+          _scene->moved(*index);
+        }
+      }
+    } else {
+      transforms[*target] = dst;
+      _scene->moved(*target);
+    }
   }
 }
 
 void TRSGizmo::hotkey(int w, int h, const Vector2 &cursor,
                       const struct Hotkey &hotkey) {
+  auto ray = GetMouseRay(cursor, *_camera);
+  auto rot =
+      QuaternionFromEuler(ray.direction.x, ray.direction.y, ray.direction.z);
+
+  update(
+      {
+          .mouse_down = IsMouseButtonDown(MOUSE_BUTTON_LEFT),
+          // optional flag to draw the gizmos at a constant screen-space
+          // scale gizmo_state.screenspace_scale = 80.f; camera projection
+          .viewport_size = {static_cast<float>(w), static_cast<float>(h)},
+          .ray =
+              {
+                  .origin = {ray.position.x, ray.position.y, ray.position.z},
+                  .direction = {ray.direction.x, ray.direction.y,
+                                ray.direction.z},
+              },
+          .cam_yfov = 1.0f,
+          .cam_orientation = {rot.x, rot.y, rot.z, rot.w},
+      },
+      hotkey);
+}
+
+void TRSGizmo::update(const tinygizmo::FrameState &state,
+                      const struct Hotkey &hotkey) {
   if (hotkey.hotkey_ctrl == true) {
     if (_last_hotkey.hotkey_translate == false &&
         hotkey.hotkey_translate == true) {
@@ -113,76 +188,124 @@ void TRSGizmo::hotkey(int w, int h, const Vector2 &cursor,
       _local_toggle = !_local_toggle;
       std::cout << "_local_toggle: " << _local_toggle << std::endl;
     }
+    if (hotkey.hotkey_group) {
+      _group = !_group;
+      std::cout << "_group: " << _group << std::endl;
+    }
+    if (hotkey.hotkey_snap) {
+      _snap = !_snap;
+      std::cout << "_snap: " << _snap << std::endl;
+    }
+    if (hotkey.hotkey_snap_target) {
+      _snap_target = _snap_target == SnapTarget::None     ? SnapTarget::Vertex
+                     : _snap_target == SnapTarget::Vertex ? SnapTarget::Surface
+                                                          : SnapTarget::None;
+      std::cout << "_snap_target: " << static_cast<int>(_snap_target)
+                << std::endl;
+    }
   }
   _last_hotkey = _current_hotkey;
   _current_hotkey = hotkey;
 
-  auto ray = GetMouseRay(cursor, *_camera);
-  auto rot =
-      QuaternionFromEuler(ray.direction.x, ray.direction.y, ray.direction.z);
-
   _last_state = _current_state;
-  _current_state = {
-      .mouse_down = IsMouseButtonDown(MOUSE_BUTTON_LEFT),
-      // optional flag to draw the gizmos at a constant screen-space
-      // scale gizmo_state.screenspace_scale = 80.f; camera projection
-      .viewport_size = {static_cast<float>(w), static_cast<float>(h)},
-      .ray =
-          {
-              .origin = {ray.position.x, ray.position.y, ray.position.z},
-              .direction = {ray.direction.x, ray.direction.y, ray.direction.z},
-          },
-      .cam_yfov = 1.0f,
-      .cam_orientation = {rot.x, rot.y, rot.z, rot.w},
-  };
+  _current_state = state;
+  if (_snap) {
+    _current_state.snap_translation = SNAP_TRANSLATION;
+    _current_state.snap_rotation = SNAP_ROTATION;
+    _current_state.snap_scale = SNAP_SCALE;
+  }
 }
 
-void TRSGizmo::load(Drawable *drawable) {
+tinygizmo::Float3 TRSGizmo::snap_to_scene(const tinygizmo::Float3 &position,
+                                          DrawableHandle target) const {
+  auto best = position;
+  _scene->nearest(position, SNAP_RADIUS, [&](size_t index,
+                                              float best_distance) {
+    auto &shape = _scene->shapes()[index];
+    if (_scene->handle(index) == target || !shape ||
+        shape->snap_index.empty()) {
+      return best_distance;
+    }
+    auto &snap_index = shape->snap_index;
+    // the index is in the local space of the drawable. a radius that covers
+    // best_distance on the shortest axis, the world distance decides
+    auto &t = _scene->transforms()[index];
+    float radius =
+        best_distance / std::min({t.scale.x, t.scale.y, t.scale.z});
+    auto local = t.detransform_point(position);
+    auto hit = _snap_target == SnapTarget::Vertex
+                   ? snap_index.nearest_vertex(local, radius)
+                   : snap_index.nearest_surface(local, radius);
+    if (!hit) {
+      return best_distance;
+    }
+    auto world = t.transform_point(*hit);
+    float distance = (world - position).length();
+    if (distance > best_distance) {
+      return best_distance;
+    }
+    best = world;
+    return distance;
+  });
+  return best;
+}
+
+void TRSGizmo::load(DynamicMesh *mesh) {
+  build();
+  mesh->update(_positions.size(), _positions.data(), _colors.data(),
+               _indices.size(), _indices.data());
+}
+
+void TRSGizmo::build() {
   _positions.clear();
   _colors.clear();
   _indices.clear();
-  tinygizmo::AddTriangleFunc add_world_triangle =
-      [self = this](const tinygizmo::Float4 &rgba, const tinygizmo::Float3 &p0,
-                    const tinygizmo::Float3 &p1, const tinygizmo::Float3 &p2) {
+  auto add_world_mesh =
+      [self = this](const tinygizmo::Float4x4 &m,
+                    const tinygizmo::MeshComponent &mesh) {
         //
-        auto offset = self->_positions.size();
+        auto offset = static_cast<uint32_t>(self->_positions.size());
         Color color{
-            static_cast<unsigned char>(std::max(0.0f, rgba.x) * 255),
-            static_cast<unsigned char>(std::max(0.0f, rgba.y) * 255),
-            static_cast<unsigned char>(std::max(0.0f, rgba.z) * 255),
-            static_cast<unsigned char>(std::max(0.0f, rgba.w) * 255),
+            static_cast<unsigned char>(std::max(0.0f, mesh.color.x) * 255),
+            static_cast<unsigned char>(std::max(0.0f, mesh.color.y) * 255),
+            static_cast<unsigned char>(std::max(0.0f, mesh.color.z) * 255),
+            static_cast<unsigned char>(std::max(0.0f, mesh.color.w) * 255),
         };
-        self->_positions.push_back({p0.x, p0.y, p0.z});
-        self->_positions.push_back({p1.x, p1.y, p1.z});
-        self->_positions.push_back({p2.x, p2.y, p2.z});
-        self->_colors.push_back(color);
-        self->_colors.push_back(color);
-        self->_colors.push_back(color);
-        self->_indices.push_back(offset + 0);
-        self->_indices.push_back(offset + 1);
-        self->_indices.push_back(offset + 2);
+        for (auto &v : mesh.vertices) {
+          auto p = m.transform_point(v.position);
+          self->_positions.push_back({p.x, p.y, p.z});
+        }
+        self->_colors.insert(self->_colors.end(), mesh.vertices.size(), color);
+        for (auto &t : mesh.triangles) {
+          self->_indices.push_back(offset + t.x);
+          self->_indices.push_back(offset + t.y);
+          self->_indices.push_back(offset + t.z);
+        }
       };
 
-  for (auto &target : this->_scene) {
-    auto [draw_scale, p, ray] = _current_state.gizmo_transform_and_local_ray(
-        _local_toggle, target->transform);
+  for (auto handle : _selection) {
+    auto index = _scene->index(handle);
+    if (!index) {
+      continue;
+    }
+    auto &transform = _scene->transforms()[*index];
+    auto [draw_scale, p, ray] =
+        _current_state.gizmo_transform_and_local_ray(_local_toggle, transform);
     auto gizmoMatrix = p.matrix() * tinygizmo::Float4x4::scaling(
                                         draw_scale, draw_scale, draw_scale);
+    // the level of detail that intersect() picks against
+    auto pixels = _current_state.pixels_per_unit(transform.position);
     switch (this->_visible) {
     case GizmoMode::Translation:
-      tinygizmo::TranslationGizmo::mesh(gizmoMatrix, add_world_triangle, _t);
+      tinygizmo::TranslationGizmo::mesh(gizmoMatrix, add_world_mesh, _t,
+                                        pixels);
       break;
     case GizmoMode::Rotation:
-      tinygizmo::RotationGizmo::mesh(gizmoMatrix, add_world_triangle, _r);
+      tinygizmo::RotationGizmo::mesh(gizmoMatrix, add_world_mesh, _r, pixels);
       break;
     case GizmoMode::Scaling:
-      tinygizmo::ScalingGizmo::mesh(gizmoMatrix, add_world_triangle, _s);
+      tinygizmo::ScalingGizmo::mesh(gizmoMatrix, add_world_mesh, _s, pixels);
       break;
     }
   }
-
-  if (_positions.size() && _indices.size()) {
-    drawable->load(_positions.size(), _positions.data(), _colors.data(),
-                   _indices.size(), _indices.data(), true);
-  }
 }
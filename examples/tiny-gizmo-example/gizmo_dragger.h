@@ -1,8 +1,8 @@
 #pragma once
-#include "drawable.h"
 #include "rdrag.h"
-#include <list>
+#include "scene.h"
 #include <tinygizmo.h>
+#include <vector>
 
 enum class GizmoMode {
   Translation,
@@ -10,19 +10,32 @@ enum class GizmoMode {
   Scaling,
 };
 
+// what a translation snaps to in the rest of the scene
+enum class SnapTarget {
+  None,
+  Vertex,
+  Surface,
+};
+
 struct Hotkey {
   bool hotkey_ctrl = false;
   bool hotkey_translate = false;
   bool hotkey_rotate = false;
   bool hotkey_scale = false;
   bool hotkey_local = false;
+  bool hotkey_group = false;
+  bool hotkey_snap = false;
+  bool hotkey_snap_target = false;
 };
 
 class TRSGizmo : public Dragger {
   GizmoMode _visible = GizmoMode::Translation;
   Camera *_camera;
-  std::list<std::shared_ptr<Drawable>> _scene;
-  std::shared_ptr<Drawable> _gizmo_target;
+  Scene *_scene;
+  // the gizmos are drawn on these
+  std::vector<DrawableHandle> _selection;
+  // the one the drag began on
+  std::optional<DrawableHandle> _gizmo_target;
 
   Hotkey _current_hotkey = {0};
   Hotkey _last_hotkey = {0};
@@ -30,25 +43,49 @@ class TRSGizmo : public Dragger {
   tinygizmo::FrameState _last_state;
   bool _local_toggle = true;
   bool _uniform = true;
+  // drag the whole selection with the picked one
+  bool _group = false;
+  tinygizmo::GroupDrag _group_drag;
+  // increment snapping of every drag
+  bool _snap = false;
+  SnapTarget _snap_target = SnapTarget::None;
 
   std::optional<tinygizmo::TranslationGizmo::GizmoComponentType> _t = {};
   std::optional<tinygizmo::RotationGizmo::GizmoComponentType> _r = {};
   std::optional<tinygizmo::ScalingGizmo::GizmoComponentType> _s = {};
   tinygizmo::RayState _ray_state;
 
+  // begin() picks over these. the live part of _selection, storage reused
+  std::vector<DrawableHandle> _targets;
+  std::vector<tinygizmo::Transform> _transforms;
+
   std::vector<Vector3> _positions;
   std::vector<Color> _colors;
-  std::vector<unsigned short> _indices;
+  std::vector<uint32_t> _indices;
+
+  tinygizmo::Float3 snap_to_scene(const tinygizmo::Float3 &position,
+                                  DrawableHandle target) const;
 
 public:
-  TRSGizmo(Camera *camera, std::list<std::shared_ptr<Drawable>> &scene)
-      : _camera(camera), _scene(scene) {}
+  TRSGizmo(Camera *camera, Scene *scene) : _camera(camera), _scene(scene) {}
+
+  const std::vector<DrawableHandle> &selection() const { return _selection; }
+  // additive toggles handle in the selection. otherwise the selection
+  // becomes handle, or nothing
+  void select(std::optional<DrawableHandle> handle, bool additive = false);
 
   void begin(const Vector2 &cursor) override;
   void end(const Vector2 &cursor) override;
   void drag(const DragState &state, int w, int h,
             const Vector2 &cursor) override;
 
+  // builds the FrameState from raylib input and calls update()
   void hotkey(int w, int h, const Vector2 &cursor, const Hotkey &hotkey);
-  void load(Drawable *drawable);
+  // no raylib. a trace replay feeds recorded frames here
+  void update(const tinygizmo::FrameState &state, const Hotkey &hotkey);
+  const tinygizmo::FrameState &frame_state() const { return _current_state; }
+
+  // build() fills the gizmo mesh on the cpu, load() also uploads it
+  void build();
+  void load(DynamicMesh *mesh);
 };
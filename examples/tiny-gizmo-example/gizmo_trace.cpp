@@ -0,0 +1,145 @@
+#include "gizmo_trace.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+static const char TRACE_MAGIC[4] = {'T', 'G', 'Z', '2'};
+static const size_t TRACE_FLOATS = 14;
+static const size_t TRACE_FRAME_SIZE =
+    sizeof(uint16_t) + TRACE_FLOATS * sizeof(float);
+
+TraceRecorder::TraceRecorder(const char *path)
+    : _out(path, std::ios::binary) {
+  if (_out.is_open()) {
+    _out.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+  }
+}
+
+void TraceRecorder::record(const TraceFrame &frame) {
+  auto &s = frame.state;
+  uint16_t flags = (s.mouse_down ? 1 : 0) | (frame.left_button ? 2 : 0) |
+                   (frame.hotkey.hotkey_ctrl ? 4 : 0) |
+                   (frame.hotkey.hotkey_translate ? 8 : 0) |
+                   (frame.hotkey.hotkey_rotate ? 16 : 0) |
+                   (frame.hotkey.hotkey_scale ? 32 : 0) |
+                   (frame.hotkey.hotkey_local ? 64 : 0) |
+                   (s.pick_mode == tinygizmo::PickMode::Analytic ? 128 : 0) |
+                   (frame.hotkey.hotkey_group ? 256 : 0) |
+                   (frame.hotkey.hotkey_snap ? 512 : 0) |
+                   (frame.hotkey.hotkey_snap_target ? 1024 : 0);
+  float values[TRACE_FLOATS] = {
+      s._screenspace_scale,   s.viewport_size.x,     s.viewport_size.y,
+      s.ray.origin.x,         s.ray.origin.y,        s.ray.origin.z,
+      s.ray.direction.x,      s.ray.direction.y,     s.ray.direction.z,
+      s.cam_yfov,             s.cam_orientation.x,   s.cam_orientation.y,
+      s.cam_orientation.z,    s.cam_orientation.w,
+  };
+  _out.write(reinterpret_cast<const char *>(&flags), sizeof(flags));
+  _out.write(reinterpret_cast<const char *>(values), sizeof(values));
+}
+
+std::optional<std::vector<TraceFrame>> load_trace(const char *path) {
+  std::ifstream in(path, std::ios::binary);
+  char magic[4];
+  if (!in.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + 4, TRACE_MAGIC)) {
+    return {};
+  }
+
+  std::vector<TraceFrame> frames;
+  char buffer[TRACE_FRAME_SIZE];
+  while (in.read(buffer, sizeof(buffer))) {
+    uint16_t flags;
+    float v[TRACE_FLOATS];
+    std::copy(buffer, buffer + sizeof(flags),
+              reinterpret_cast<char *>(&flags));
+    std::copy(buffer + sizeof(flags), buffer + sizeof(buffer),
+              reinterpret_cast<char *>(v));
+    frames.push_back({
+        .state =
+            {
+                .mouse_down = (flags & 1) != 0,
+                ._screenspace_scale = v[0],
+                .viewport_size = {v[1], v[2]},
+                .ray = {{v[3], v[4], v[5]}, {v[6], v[7], v[8]}},
+                .cam_yfov = v[9],
+                .cam_orientation = {v[10], v[11], v[12], v[13]},
+                .pick_mode = (flags & 128) ? tinygizmo::PickMode::Analytic
+                                           : tinygizmo::PickMode::Mesh,
+            },
+        .hotkey =
+            {
+                .hotkey_ctrl = (flags & 4) != 0,
+                .hotkey_translate = (flags & 8) != 0,
+                .hotkey_rotate = (flags & 16) != 0,
+                .hotkey_scale = (flags & 32) != 0,
+                .hotkey_local = (flags & 64) != 0,
+                .hotkey_group = (flags & 256) != 0,
+                .hotkey_snap = (flags & 512) != 0,
+                .hotkey_snap_target = (flags & 1024) != 0,
+            },
+        .left_button = (flags & 2) != 0,
+    });
+  }
+  return frames;
+}
+
+namespace {
+
+struct StageTime {
+  const char *name;
+  size_t count = 0;
+  double total_ns = 0;
+  double max_ns = 0;
+
+  template <typename F> void measure(const F &f) {
+    auto begin = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+    ++count;
+    total_ns += ns;
+    max_ns = std::max(max_ns, ns);
+  }
+
+  void print() const {
+    printf("  %-6s: %6zu calls, %10.0f ns/call, max %10.0f ns\n", name, count,
+           count ? total_ns / count : 0.0, max_ns);
+  }
+};
+
+} // namespace
+
+void replay_trace(std::span<const TraceFrame> frames, TRSGizmo *gizmo) {
+  StageTime update{"update"};
+  StageTime begin{"begin"};
+  StageTime drag{"drag"};
+  StageTime end{"end"};
+  StageTime build{"build"};
+
+  // the cursor is only drawn by Drag::process. the gizmo uses the ray
+  const Vector2 cursor = {0, 0};
+  DragState state = {.cursor_begin = cursor};
+  bool button = false;
+  for (auto &frame : frames) {
+    auto w = static_cast<int>(frame.state.viewport_size.x);
+    auto h = static_cast<int>(frame.state.viewport_size.y);
+    update.measure([&] { gizmo->update(frame.state, frame.hotkey); });
+    if (button != frame.left_button) {
+      if (frame.left_button) {
+        begin.measure([&] { gizmo->begin(cursor); });
+      } else {
+        end.measure([&] { gizmo->end(cursor); });
+      }
+    } else if (frame.left_button) {
+      drag.measure([&] { gizmo->drag(state, w, h, cursor); });
+    }
+    button = frame.left_button;
+    build.measure([&] { gizmo->build(); });
+  }
+
+  printf("replay %zu frames\n", frames.size());
+  for (auto *stage : {&update, &begin, &drag, &end, &build}) {
+    stage->print();
+  }
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include "gizmo_dragger.h"
+#include <fstream>
+#include <optional>
+#include <span>
+#include <vector>
+
+// one frame of gizmo input
+struct TraceFrame {
+  tinygizmo::FrameState state;
+  Hotkey hotkey;
+  bool left_button = false;
+};
+
+/// trace file
+///   "TGZ2"
+///   per frame: uint16 flags, 14 float (host byte order)
+///     flags: mouse_down, left_button, ctrl, translate, rotate, scale, local,
+///            pick_mode analytic, group, snap, snap_target
+///     float: screenspace_scale, viewport(2), ray origin(3), direction(3),
+///            cam_yfov, cam_orientation(4)
+class TraceRecorder {
+  std::ofstream _out;
+
+public:
+  TraceRecorder(const char *path);
+  bool is_open() const { return _out.is_open(); }
+  void record(const TraceFrame &frame);
+};
+
+std::optional<std::vector<TraceFrame>> load_trace(const char *path);
+
+// Feeds the frames through update/begin/drag/end/build the way the main loop
+// and Drag::process do, without a window. Prints the time of each stage.
+void replay_trace(std::span<const TraceFrame> frames, TRSGizmo *gizmo);
@@ -0,0 +1,220 @@
+#include "instancing.h"
+#include <raylib/external/glad.h>
+#include <map>
+#include <raymath.h>
+#include <rlgl.h>
+#include <tuple>
+
+// the default shader of rlgl, with the model matrix from an attribute
+static const char VS[] = R"(#version 330
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec4 vertexColor;
+in mat4 instanceTransform;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+uniform mat4 mvp;
+void main()
+{
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor;
+    gl_Position = mvp*instanceTransform*vec4(vertexPosition, 1.0);
+}
+)";
+
+static const char FS[] = R"(#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+out vec4 finalColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+void main()
+{
+    finalColor = texture(texture0, fragTexCoord)*colDiffuse*fragColor;
+}
+)";
+
+void InstancedRenderer::rebuild(Scene &scene) {
+  for (auto &group : _groups) {
+    rlUnloadVertexBuffer(group.vbo);
+  }
+  _groups.clear();
+  _instances.clear();
+  _first.clear();
+
+  // a mesh, the texture and color of its material
+  std::map<std::tuple<unsigned int, unsigned int, uint32_t>, uint32_t> keys;
+  auto models = scene.models();
+  auto transforms = scene.transforms();
+  for (size_t i = 0; i < scene.size(); ++i) {
+    _first.push_back(static_cast<uint32_t>(_instances.size()));
+    auto &model = models[i];
+    auto matrix = transforms[i].matrix();
+    for (int m = 0; m < model.meshCount; ++m) {
+      auto &mesh = model.meshes[m];
+      auto &material = model.materials[model.meshMaterial[m]];
+      auto &map = material.maps[MATERIAL_MAP_DIFFUSE];
+      auto color = map.color;
+      auto key = std::make_tuple(
+          mesh.vaoId, map.texture.id,
+          static_cast<uint32_t>(color.r | color.g << 8 | color.b << 16 |
+                                color.a << 24));
+      auto [found, inserted] =
+          keys.emplace(key, static_cast<uint32_t>(_groups.size()));
+      if (inserted) {
+        _groups.push_back({.mesh = mesh, .material = material});
+      }
+      auto &group = _groups[found->second];
+      _instances.push_back(
+          {found->second, static_cast<uint32_t>(group.matrices.size())});
+      group.matrices.push_back(matrix);
+    }
+  }
+  _first.push_back(static_cast<uint32_t>(_instances.size()));
+
+  for (auto &group : _groups) {
+    group.dirty_end = group.matrices.size();
+  }
+  // all of them are new
+  scene.flush_moved([](size_t) {});
+  _revision = scene.revision();
+}
+
+void InstancedRenderer::upload(Group &group) {
+  if (group.dirty_begin >= group.dirty_end) {
+    return;
+  }
+  auto data = group.matrices.data();
+  if (group.matrices.size() > group.capacity) {
+    rlUnloadVertexBuffer(group.vbo);
+    group.capacity = std::max(group.matrices.size(), group.capacity * 2);
+    group.vbo = rlLoadVertexBuffer(
+        nullptr, group.capacity * sizeof(tinygizmo::Float4x4), true);
+    rlDisableVertexBuffer();
+    group.dirty_begin = 0;
+    group.dirty_end = group.matrices.size();
+  }
+  rlUpdateVertexBuffer(
+      group.vbo, data + group.dirty_begin,
+      (group.dirty_end - group.dirty_begin) * sizeof(tinygizmo::Float4x4),
+      group.dirty_begin * sizeof(tinygizmo::Float4x4));
+  group.dirty_begin = 0;
+  group.dirty_end = 0;
+}
+
+void InstancedRenderer::draw(const Group &group) {
+  auto &mesh = group.mesh;
+  auto &map = group.material.maps[MATERIAL_MAP_DIFFUSE];
+  rlEnableShader(_shader.id);
+  float color[4] = {map.color.r / 255.0f, map.color.g / 255.0f,
+                    map.color.b / 255.0f, map.color.a / 255.0f};
+  rlSetUniform(_shader.locs[SHADER_LOC_COLOR_DIFFUSE], color,
+               SHADER_UNIFORM_VEC4, 1);
+  // the instance matrices are in world space
+  auto mvp = MatrixMultiply(
+      MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview()),
+      rlGetMatrixProjection());
+  rlSetUniformMatrix(_shader.locs[SHADER_LOC_MATRIX_MVP], mvp);
+  int slot = 0;
+  rlActiveTextureSlot(slot);
+  rlEnableTexture(map.texture.id);
+  rlSetUniform(_shader.locs[SHADER_LOC_MAP_DIFFUSE], &slot, SHADER_UNIFORM_INT,
+               1);
+
+  rlEnableVertexArray(mesh.vaoId);
+  // the instance attributes belong to the vao of the mesh, that the groups
+  // of other materials share
+  auto location = _shader.locs[SHADER_LOC_MATRIX_MODEL];
+  rlEnableVertexBuffer(group.vbo);
+  for (int i = 0; i < 4; ++i) {
+    rlEnableVertexAttribute(location + i);
+    rlSetVertexAttribute(location + i, 4, RL_FLOAT, false,
+                         sizeof(tinygizmo::Float4x4),
+                         (void *)(i * sizeof(tinygizmo::Float4)));
+    rlSetVertexAttributeDivisor(location + i, 1);
+  }
+  rlDisableVertexBuffer();
+  // white for a mesh without colors, as DrawMesh does
+  if (!mesh.vboId[3] && _shader.locs[SHADER_LOC_VERTEX_COLOR] != -1) {
+    float white[4] = {1, 1, 1, 1};
+    rlSetVertexAttributeDefault(_shader.locs[SHADER_LOC_VERTEX_COLOR], white,
+                                SHADER_ATTRIB_VEC4, 4);
+    rlDisableVertexAttribute(_shader.locs[SHADER_LOC_VERTEX_COLOR]);
+  }
+  auto count = static_cast<int>(group.matrices.size());
+  if (has_wide_indices(mesh)) {
+    // rlgl draws 16 bit indices only
+    glDrawElementsInstanced(GL_TRIANGLES, mesh.triangleCount * 3,
+                            GL_UNSIGNED_INT, nullptr, count);
+  } else if (mesh.indices) {
+    rlDrawVertexArrayElementsInstanced(0, mesh.triangleCount * 3, 0, count);
+  } else {
+    rlDrawVertexArrayInstanced(0, mesh.vertexCount, count);
+  }
+  // the locations may be ones raylib uses for tangents or texcoord2, that a
+  // DrawMesh of the same vao would then read from the instance buffer
+  for (int i = 0; i < 4; ++i) {
+    rlDisableVertexAttribute(location + i);
+    rlSetVertexAttributeDivisor(location + i, 0);
+  }
+  rlDisableVertexArray();
+  rlDisableTexture();
+  rlDisableShader();
+}
+
+void InstancedRenderer::draw(Scene &scene,
+                             std::span<const tinygizmo::Plane> frustum) {
+  if (!_shader.id) {
+    _shader = LoadShaderFromMemory(VS, FS);
+    _shader.locs[SHADER_LOC_MATRIX_MODEL] =
+        GetShaderLocationAttrib(_shader, "instanceTransform");
+  }
+  if (_revision != scene.revision()) {
+    rebuild(scene);
+  } else {
+    auto transforms = scene.transforms();
+    scene.flush_moved([&](size_t index) {
+      auto matrix = transforms[index].matrix();
+      for (auto i = _first[index]; i < _first[index + 1]; ++i) {
+        auto [g, instance] = _instances[i];
+        auto &group = _groups[g];
+        group.matrices[instance] = matrix;
+        if (group.dirty_begin >= group.dirty_end) {
+          group.dirty_begin = instance;
+          group.dirty_end = instance + 1;
+        } else {
+          group.dirty_begin = std::min<size_t>(group.dirty_begin, instance);
+          group.dirty_end = std::max<size_t>(group.dirty_end, instance + 1);
+        }
+      }
+    });
+  }
+
+  // the groups with an instance in view
+  _visible.assign(_groups.size(), false);
+  scene.frustum(frustum, [&](size_t index) {
+    for (auto i = _first[index]; i < _first[index + 1]; ++i) {
+      _visible[_instances[i].group] = true;
+    }
+  });
+  for (size_t g = 0; g < _groups.size(); ++g) {
+    upload(_groups[g]);
+    if (_visible[g]) {
+      draw(_groups[g]);
+    }
+  }
+}
+
+void InstancedRenderer::unload() {
+  for (auto &group : _groups) {
+    rlUnloadVertexBuffer(group.vbo);
+  }
+  _groups.clear();
+  _instances.clear();
+  _first.clear();
+  _revision = UINT64_MAX;
+  if (_shader.id) {
+    UnloadShader(_shader);
+    _shader = {};
+  }
+}
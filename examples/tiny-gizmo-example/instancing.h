@@ -0,0 +1,47 @@
+#pragma once
+#include "scene.h"
+#include <raylib.h>
+#include <span>
+#include <vector>
+
+// Draws the drawables of a Scene with one instanced draw for each mesh and
+// material they share. The instance matrices of a group stay in a gpu
+// buffer, and only the ones that Scene::moved() reports are written again.
+// A Scene::add() or remove() rebuilds the groups. A group with no instance
+// in the frustum is not drawn.
+class InstancedRenderer {
+  struct Group {
+    Mesh mesh;
+    Material material;
+    std::vector<tinygizmo::Float4x4> matrices;
+    unsigned int vbo = 0;
+    size_t capacity = 0;
+    // the matrices to upload, [begin, end)
+    size_t dirty_begin = 0;
+    size_t dirty_end = 0;
+  };
+  std::vector<Group> _groups;
+  // where the matrix of each mesh of each drawable is
+  struct Instance {
+    uint32_t group;
+    uint32_t index;
+  };
+  std::vector<Instance> _instances;
+  // by dense index, [_first[i], _first[i + 1]) of _instances
+  std::vector<uint32_t> _first;
+  // by group, for the frame
+  std::vector<bool> _visible;
+  uint64_t _revision = UINT64_MAX;
+  // the default shader with a per instance model matrix
+  Shader _shader = {};
+
+  void rebuild(Scene &scene);
+  void upload(Group &group);
+  void draw(const Group &group);
+
+public:
+  // the planes of camera_frustum
+  void draw(Scene &scene, std::span<const tinygizmo::Plane> frustum);
+  // before CloseWindow
+  void unload();
+};
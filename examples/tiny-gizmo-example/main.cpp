@@ -5,31 +5,83 @@
 
 #include "drawable.h"
 #include "gizmo_dragger.h"
+#include "gizmo_trace.h"
+#include "instancing.h"
 #include "orbit_camera.h"
 #include "rdrag.h"
+#include "scene.h"
 #include "teapot.h"
 #include <rlgl.h>
+#include <stdio.h>
+#include <string.h>
 
 int main(int argc, char *argv[]) {
+  // --record trace.bin: save the gizmo input of every frame
+  // --replay trace.bin: run a saved trace without a window and time it
+  const char *record_path = nullptr;
+  const char *replay_path = nullptr;
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--record") == 0) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--replay") == 0) {
+      replay_path = argv[++i];
+    }
+  }
+
+  std::span<const Vertex> teapot = {(Vertex *)teapot_vertices,
+                                    _countof(teapot_vertices) / 6};
+  auto teapot_shape = std::make_shared<Shape>();
+  teapot_shape->build(teapot, teapot_triangles);
+
+  Drawable a{.name = "first-example-gizmo", .shape = teapot_shape};
+  a.transform.position = {-2, 0, 0};
+
+  Drawable b{.name = "second-example-gizmo", .shape = teapot_shape};
+  b.transform.position = {2, 0, 0};
+
+  if (replay_path) {
+    auto frames = load_trace(replay_path);
+    if (!frames) {
+      fprintf(stderr, "can not read trace: %s\n", replay_path);
+      return EXIT_FAILURE;
+    }
+    // no window. no models, the shapes are all picking and snapping need
+    Scene scene;
+    Camera3D camera{};
+    TRSGizmo gizmo(&camera, &scene);
+    gizmo.select(scene.add(std::move(a)), true);
+    gizmo.select(scene.add(std::move(b)), true);
+    replay_trace(*frames, &gizmo);
+    // the end state, to compare runs of the same trace
+    for (size_t i = 0; i < scene.size(); ++i) {
+      auto &t = scene.transforms()[i];
+      printf("%s: position [%g, %g, %g] orientation [%g, %g, %g, %g] "
+             "scale [%g, %g, %g]\n",
+             scene.names()[i].c_str(), t.position.x, t.position.y, t.position.z,
+             t.orientation.x, t.orientation.y, t.orientation.z,
+             t.orientation.w, t.scale.x, t.scale.y, t.scale.z);
+    }
+    return EXIT_SUCCESS;
+  }
+
+  std::optional<TraceRecorder> recorder;
+  if (record_path) {
+    recorder.emplace(record_path);
+    if (!recorder->is_open()) {
+      fprintf(stderr, "can not write trace: %s\n", record_path);
+      return EXIT_FAILURE;
+    }
+  }
 
   InitWindow(1280, 800, "tiny-gizmo-example-app");
 
-  auto a = std::make_shared<Drawable>();
-  a->name = "first-example-gizmo";
-  a->transform.position = {-2, 0, 0};
-  a->load({(Vertex *)teapot_vertices, _countof(teapot_vertices) / 6},
-          teapot_triangles, false);
-
-  auto b = std::make_shared<Drawable>();
-  b->name = "second-example-gizmo";
-  b->transform.position = {2, 0, 0};
-  b->load({(Vertex *)teapot_vertices, _countof(teapot_vertices) / 6},
-          teapot_triangles, false);
-
-  std::list<std::shared_ptr<Drawable>> scene{
-      a,
-      b,
-  };
+  // the second load finds the mesh of the first. the teapots are drawn in
+  // one instanced draw
+  MeshCache meshes;
+  a.load(meshes, teapot, teapot_triangles);
+  b.load(meshes, teapot, teapot_triangles);
+  InstancedRenderer renderer;
+  Scene scene;
 
   OrbitCamera orbit;
   Camera3D camera{
@@ -49,8 +101,10 @@ int main(int argc, char *argv[]) {
       .draggable = std::make_shared<CameraShiftDragger>(&camera, &orbit),
   };
 
-  auto gizmo = std::make_shared<TRSGizmo>(&camera, scene);
-  Drawable gizmo_mesh;
+  auto gizmo = std::make_shared<TRSGizmo>(&camera, &scene);
+  gizmo->select(scene.add(std::move(a)), true);
+  gizmo->select(scene.add(std::move(b)), true);
+  DynamicMesh gizmo_mesh;
   Drag left_drag{
       .draggable = gizmo,
   };
@@ -66,8 +120,18 @@ int main(int argc, char *argv[]) {
         .hotkey_rotate = IsKeyDown(KEY_R),
         .hotkey_scale = IsKeyDown(KEY_S),
         .hotkey_local = IsKeyPressed(KEY_L),
+        .hotkey_group = IsKeyPressed(KEY_G),
+        .hotkey_snap = IsKeyPressed(KEY_N),
+        .hotkey_snap_target = IsKeyPressed(KEY_V),
     };
     gizmo->hotkey(w, h, cursor, active_hotkey);
+    if (recorder) {
+      recorder->record({
+          .state = gizmo->frame_state(),
+          .hotkey = active_hotkey,
+          .left_button = IsMouseButtonDown(MOUSE_BUTTON_LEFT),
+      });
+    }
 
     // camera
     dolly(&camera);
@@ -87,9 +151,9 @@ int main(int argc, char *argv[]) {
 
       {
         BeginMode3D(camera);
-        // teapot
-        a->draw();
-        b->draw();
+        // the groups in view
+        renderer.draw(scene,
+                      camera_frustum(camera, static_cast<float>(w) / h));
         DrawGrid(10, 1.0);
 
         // draw gizmo
@@ -103,6 +167,9 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  gizmo_mesh.unload();
+  renderer.unload();
+  meshes.unload();
   CloseWindow();
   return EXIT_SUCCESS;
 }
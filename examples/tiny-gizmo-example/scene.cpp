@@ -0,0 +1,142 @@
+#include "scene.h"
+#include <rlgl.h>
+
+tinygizmo::AABB transform_bounds(const tinygizmo::Transform &transform,
+                                 const tinygizmo::AABB &bounds) {
+  if (bounds.empty()) {
+    // no mesh. only the position
+    return {transform.position, transform.position};
+  }
+  tinygizmo::AABB aabb;
+  for (int i = 0; i < 8; ++i) {
+    aabb.extend(transform.transform_point({
+        (i & 1) ? bounds.max.x : bounds.min.x,
+        (i & 2) ? bounds.max.y : bounds.min.y,
+        (i & 4) ? bounds.max.z : bounds.min.z,
+    }));
+  }
+  return aabb;
+}
+
+tinygizmo::AABB Scene::world_bounds(size_t index) const {
+  auto &shape = _shapes[index];
+  return transform_bounds(_transforms[index],
+                          shape ? shape->snap_index.bounds : tinygizmo::AABB{});
+}
+
+DrawableHandle Scene::add(Drawable drawable) {
+  auto index = static_cast<uint32_t>(size());
+  uint32_t slot;
+  if (_free_slot != UINT32_MAX) {
+    slot = _free_slot;
+    _free_slot = _slots[slot].index;
+    _slots[slot].index = index;
+  } else {
+    slot = static_cast<uint32_t>(_slots.size());
+    _slots.push_back({index, 0});
+  }
+  ++_revision;
+  _slot_of.push_back(slot);
+  _transforms.push_back(drawable.transform);
+  _models.push_back(drawable.model);
+  _names.push_back(std::move(drawable.name));
+  _shapes.push_back(std::move(drawable.shape));
+  _proxies.push_back(_tree.insert(world_bounds(index), slot));
+  return {slot, _slots[slot].generation};
+}
+
+void Scene::remove(DrawableHandle handle) {
+  auto found = this->index(handle);
+  if (!found) {
+    return;
+  }
+  auto index = *found;
+  _tree.remove(_proxies[index]);
+  ++_revision;
+
+  auto last = size() - 1;
+  if (index != last) {
+    _slot_of[index] = _slot_of[last];
+    _transforms[index] = _transforms[last];
+    _models[index] = _models[last];
+    _names[index] = std::move(_names[last]);
+    _shapes[index] = std::move(_shapes[last]);
+    _proxies[index] = _proxies[last];
+    _slots[_slot_of[index]].index = static_cast<uint32_t>(index);
+  }
+  _slot_of.pop_back();
+  _transforms.pop_back();
+  _models.pop_back();
+  _names.pop_back();
+  _shapes.pop_back();
+  _proxies.pop_back();
+
+  auto &slot = _slots[handle.slot];
+  ++slot.generation;
+  slot.moved = false;
+  slot.index = _free_slot;
+  _free_slot = handle.slot;
+}
+
+void Scene::moved(size_t index) {
+  _tree.move(_proxies[index], world_bounds(index));
+  auto slot = _slot_of[index];
+  if (!_slots[slot].moved) {
+    _slots[slot].moved = true;
+    _moved.push_back(slot);
+  }
+}
+
+std::optional<std::tuple<DrawableHandle, float>>
+Scene::raycast(const tinygizmo::Ray &ray) const {
+  std::optional<std::tuple<DrawableHandle, float>> hit;
+  _tree.raycast(ray, std::numeric_limits<float>::infinity(),
+                [&](uint32_t slot, float max_t) {
+                  auto index = _slots[slot].index;
+                  auto &shape = _shapes[index];
+                  if (!shape) {
+                    return max_t;
+                  }
+                  // t is the same along the local ray
+                  auto t = shape->triangles.intersect(
+                      ray.detransform(_transforms[index]));
+                  if (t < max_t) {
+                    hit = std::make_tuple(handle(index), t);
+                    return t;
+                  }
+                  return max_t;
+                });
+  return hit;
+}
+
+std::array<tinygizmo::Plane, 6> camera_frustum(const Camera &camera,
+                                               float aspect) {
+  auto view = GetCameraMatrix(camera);
+  auto projection =
+      camera.projection == CAMERA_PERSPECTIVE
+          ? MatrixPerspective(camera.fovy * DEG2RAD, aspect,
+                              RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR)
+          : MatrixOrtho(-camera.fovy * aspect / 2, camera.fovy * aspect / 2,
+                        -camera.fovy / 2, camera.fovy / 2,
+                        RL_CULL_DISTANCE_NEAR, RL_CULL_DISTANCE_FAR);
+  // column major, clip = m * world
+  auto m = MatrixMultiply(view, projection);
+  const tinygizmo::Float4 rows[] = {
+      {m.m0, m.m4, m.m8, m.m12},
+      {m.m1, m.m5, m.m9, m.m13},
+      {m.m2, m.m6, m.m10, m.m14},
+      {m.m3, m.m7, m.m11, m.m15},
+  };
+  // -w <= x, y, z <= w
+  std::array<tinygizmo::Plane, 6> planes;
+  for (int i = 0; i < 6; ++i) {
+    auto &r = rows[i / 2];
+    float sign = (i % 2) ? -1.0f : 1.0f;
+    tinygizmo::Float3 n = {rows[3].x + sign * r.x, rows[3].y + sign * r.y,
+                           rows[3].z + sign * r.z};
+    float d = rows[3].w + sign * r.w;
+    float length = n.length();
+    planes[i] = {n.scale(1.0f / length), d / length};
+  }
+  return planes;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include "drawable.h"
+#include <array>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <tinygizmo_aabbtree.h>
+#include <tuple>
+#include <vector>
+
+// A drawable in a Scene. It stays valid until the drawable is removed, and
+// a removed one is told apart from the next one in its slot by generation.
+struct DrawableHandle {
+  uint32_t slot = UINT32_MAX;
+  uint32_t generation = 0;
+
+  bool operator==(const DrawableHandle &) const = default;
+};
+
+// The drawables of the example, and a dynamic AABB tree over their world
+// bounds for picking, culling and snapping. The transforms, models, names
+// and shapes are kept in separate dense arrays, so that the per-frame
+// passes walk memory in order. A dense index changes when a drawable is
+// removed, a handle does not. Call moved() after changing a transform.
+class Scene {
+  struct Slot {
+    // dense index, or the next free slot while free
+    uint32_t index;
+    uint32_t generation;
+    // in _moved
+    bool moved = false;
+  };
+  std::vector<Slot> _slots;
+  uint32_t _free_slot = UINT32_MAX;
+  // bumped by add() and remove()
+  uint64_t _revision = 0;
+  // slots moved() since the last flush_moved()
+  std::vector<uint32_t> _moved;
+
+  // dense, in the same order. remove() moves the last drawable into the hole
+  std::vector<uint32_t> _slot_of;
+  std::vector<tinygizmo::Transform> _transforms;
+  std::vector<Model> _models;
+  std::vector<std::string> _names;
+  std::vector<std::shared_ptr<const Shape>> _shapes;
+  // tree leaf of each drawable
+  std::vector<uint32_t> _proxies;
+  // the items are slots, which remove() leaves alone
+  tinygizmo::AabbTree _tree;
+
+  tinygizmo::AABB world_bounds(size_t index) const;
+
+public:
+  size_t size() const { return _transforms.size(); }
+  DrawableHandle handle(size_t index) const {
+    auto slot = _slot_of[index];
+    return {slot, _slots[slot].generation};
+  }
+  // the dense index of the drawable, none if it was removed
+  std::optional<size_t> index(DrawableHandle handle) const {
+    if (handle.slot >= _slots.size() ||
+        _slots[handle.slot].generation != handle.generation) {
+      return {};
+    }
+    return _slots[handle.slot].index;
+  }
+
+  // by dense index
+  std::span<tinygizmo::Transform> transforms() { return _transforms; }
+  std::span<const tinygizmo::Transform> transforms() const {
+    return _transforms;
+  }
+  std::span<const Model> models() const { return _models; }
+  std::span<const std::string> names() const { return _names; }
+  std::span<const std::shared_ptr<const Shape>> shapes() const {
+    return _shapes;
+  }
+  const tinygizmo::AabbTree &tree() const { return _tree; }
+  // changes when add() or remove() change the dense indices
+  uint64_t revision() const { return _revision; }
+
+  // the model may be shared with other drawables. the MeshCache owns it
+  DrawableHandle add(Drawable drawable);
+  // does nothing for a removed handle
+  void remove(DrawableHandle handle);
+  void moved(size_t index);
+
+  // visit(index) once for each drawable moved() since the last call
+  template <typename F> void flush_moved(const F &visit) {
+    for (auto slot : _moved) {
+      // removed in between, or a duplicate of a slot that was reused
+      if (_slots[slot].moved) {
+        _slots[slot].moved = false;
+        visit(size_t(_slots[slot].index));
+      }
+    }
+    _moved.clear();
+  }
+
+  void draw(size_t index) const {
+    draw_model(_models[index], _transforms[index]);
+  }
+
+  // the first drawable the ray hits, against its triangles. {handle, t}
+  std::optional<std::tuple<DrawableHandle, float>>
+  raycast(const tinygizmo::Ray &ray) const;
+
+  // visit(index) for the drawables whose bounds are not outside the frustum.
+  // the planes face inward
+  template <typename F>
+  void frustum(std::span<const tinygizmo::Plane> planes, const F &visit) const {
+    _tree.frustum(planes,
+                  [&](uint32_t slot) { visit(size_t(_slots[slot].index)); });
+  }
+
+  // visit(index, best) for the drawables whose bounds are nearer to p than
+  // best, nearer ones first. visit returns the new best, the distance of its
+  // nearest point if that is nearer. best starts at max_distance
+  template <typename F>
+  void nearest(const tinygizmo::Float3 &p, float max_distance,
+               const F &visit) const {
+    _tree.nearest(p, max_distance, [&](uint32_t slot, float best) {
+      return visit(size_t(_slots[slot].index), best);
+    });
+  }
+};
+
+// the world bounds of the local bounds under transform
+tinygizmo::AABB transform_bounds(const tinygizmo::Transform &transform,
+                                 const tinygizmo::AABB &bounds);
+
+// the view frustum of the camera, for Scene::frustum
+std::array<tinygizmo::Plane, 6> camera_frustum(const Camera &camera,
+                                               float aspect);
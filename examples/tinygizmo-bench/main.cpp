@@ -0,0 +1,987 @@
+// headless micro benchmark for tinygizmo. no window, no raylib
+#include "tinygizmo.h"
+#include "tinygizmo_aabbtree.h"
+#include "tinygizmo_geometrymesh.h"
+#include "tinygizmo_rotation.h"
+#include "tinygizmo_scaling.h"
+#include "tinygizmo_staticmesh.h"
+#include "tinygizmo_translation.h"
+#include "tinygizmo_weld.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+// count every heap allocation, to check that the per frame path has none
+static std::atomic<size_t> g_allocations = 0;
+
+void *operator new(size_t size) {
+  ++g_allocations;
+  if (auto p = malloc(size ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void *operator new(size_t size, std::align_val_t align) {
+  ++g_allocations;
+  auto a = static_cast<size_t>(align);
+  size = (size + a - 1) / a * a;
+#ifdef _MSC_VER
+  auto p = _aligned_malloc(size ? size : a, a);
+#else
+  auto p = aligned_alloc(a, size ? size : a);
+#endif
+  if (p) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete(void *p, std::align_val_t) noexcept {
+#ifdef _MSC_VER
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+void operator delete(void *p, size_t, std::align_val_t align) noexcept {
+  operator delete(p, align);
+}
+
+using namespace tinygizmo;
+
+template <typename F> double measure_ns(size_t count, const F &f) {
+  auto begin = std::chrono::steady_clock::now();
+  f();
+  auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - begin).count() / count;
+}
+
+// rays from a sphere around the origin aimed at points near the ring
+static std::vector<Ray> make_rays(size_t count, float target_radius) {
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::vector<Ray> rays;
+  rays.reserve(count);
+  while (rays.size() < count) {
+    Float3 origin{unit(rng), unit(rng), unit(rng)};
+    if (origin.length2() < 0.01f) {
+      continue;
+    }
+    origin = origin.normalize().scale(5.0f);
+    Float3 target =
+        Float3{unit(rng), unit(rng), unit(rng)}.scale(target_radius);
+    rays.push_back({origin, (target - origin).normalize()});
+  }
+  return rays;
+}
+
+// the per triangle path through the index buffer
+static float intersect_indexed(const GeometryMesh &mesh, const Ray &ray) {
+  float best_t = std::numeric_limits<float>::infinity();
+  for (auto &tri : mesh.triangles) {
+    float t;
+    if (ray.intersect_triangle(mesh.vertices[tri.x].position,
+                               mesh.vertices[tri.y].position,
+                               mesh.vertices[tri.z].position, &t) &&
+        t < best_t) {
+      best_t = t;
+    }
+  }
+  return best_t;
+}
+
+static bool bench_ring_intersect() {
+  std::vector<Float2> ring_points = {
+      {+0.025f, 1},    {-0.025f, 1},    {-0.025f, 1},    {-0.025f, 1.1f},
+      {-0.025f, 1.1f}, {+0.025f, 1.1f}, {+0.025f, 1.1f}, {+0.025f, 1}};
+  auto ring = GeometryMesh::make_lathed_geometry(
+      {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 32, ring_points, {1, 0.5f, 0.5f, 1.f},
+      {1, 0, 0, 1.f}, 0.003f);
+
+  auto rays = make_rays(100000, 1.2f);
+  std::vector<float> expected(rays.size());
+  std::vector<float> actual(rays.size());
+
+  auto indexed = measure_ns(rays.size(), [&] {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      expected[i] = intersect_indexed(ring, rays[i]);
+    }
+  });
+  auto cached = measure_ns(rays.size(), [&] {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      actual[i] = ring.triangle_cache.intersect(rays[i]);
+    }
+  });
+
+  size_t hits = 0;
+  size_t mismatch = 0;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    if (expected[i] != std::numeric_limits<float>::infinity()) {
+      ++hits;
+    }
+    if (std::abs(expected[i] - actual[i]) > 1e-4f &&
+        !(std::isinf(expected[i]) && std::isinf(actual[i]))) {
+      ++mismatch;
+    }
+  }
+
+  printf("ring32 (%zu triangles, %zu rays, %zu hits)\n", ring.triangles.size(),
+         rays.size(), hits);
+  printf("  indexed scalar : %8.1f ns/ray\n", indexed);
+  printf("  triangle cache : %8.1f ns/ray (mismatch %zu)\n", cached, mismatch);
+  return mismatch == 0;
+}
+
+// the pairwise weld compute_normals used before weld_vertices
+static std::vector<uint32_t> weld_pairwise(const std::vector<Vertex> &vertices,
+                                           double epsilon2) {
+  std::vector<uint32_t> welded(vertices.size(), UINT32_MAX);
+  for (uint32_t i = 0; i < vertices.size(); ++i) {
+    if (welded[i] == UINT32_MAX) {
+      welded[i] = i;
+      for (auto j = i + 1; j < vertices.size(); ++j) {
+        if ((vertices[j].position - vertices[i].position).length2() <
+            epsilon2) {
+          welded[j] = i;
+        }
+      }
+    }
+  }
+  return welded;
+}
+
+static bool bench_weld() {
+  printf("weld_vertices (3 copies of each position, epsilon2 = 0.0001)\n");
+  bool same = true;
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  for (size_t count = 1024; count <= 262144; count *= 4) {
+    std::vector<Vertex> vertices;
+    vertices.reserve(count);
+    while (vertices.size() < count) {
+      Float3 p = Float3{unit(rng), unit(rng), unit(rng)}.scale(10.0f);
+      for (int i = 0; i < 3 && vertices.size() < count; ++i) {
+        vertices.push_back({.position = p + Float3{0.001f * i, 0, 0}});
+      }
+    }
+    std::shuffle(vertices.begin(), vertices.end(), rng);
+
+    std::vector<uint32_t> hashed;
+    auto hashed_ns = measure_ns(count, [&] {
+      hashed = weld_vertices(vertices, 0.0001);
+    });
+    if (count <= 16384) {
+      std::vector<uint32_t> pairwise;
+      auto pairwise_ns = measure_ns(count, [&] {
+        pairwise = weld_pairwise(vertices, 0.0001);
+      });
+      same = same && hashed == pairwise;
+      printf("  %7zu vertices: hashed %6.1f ns/vertex, pairwise %8.1f "
+             "ns/vertex (%s)\n",
+             count, hashed_ns, pairwise_ns,
+             hashed == pairwise ? "same" : "MISMATCH");
+    } else {
+      printf("  %7zu vertices: hashed %6.1f ns/vertex\n", count, hashed_ns);
+    }
+  }
+  return same;
+}
+
+// the scalar definitions, to check the TINYGIZMO_SIMD backend against
+static Float4x4 mul_reference(const Float4x4 &a, const Float4x4 &b) {
+  Float4 rows[] = {a.row0(), a.row1(), a.row2(), a.row3()};
+  Float4 cols[] = {b.col0(), b.col1(), b.col2(), b.col3()};
+  Float4x4 m;
+  float *dst = &m.m00;
+  for (auto &row : rows) {
+    for (auto &col : cols) {
+      *dst++ = Float4::dot(row, col);
+    }
+  }
+  return m;
+}
+
+static Float4 transform_reference(const Float4x4 &m, const Float4 &v) {
+  return {Float4::dot(v, m.col0()), Float4::dot(v, m.col1()),
+          Float4::dot(v, m.col2()), Float4::dot(v, m.col3())};
+}
+
+static Float3 rotate_reference(const Quaternion &q, const Float3 &v) {
+  return q.xdir().scale(v.x) + q.ydir().scale(v.y) + q.zdir().scale(v.z);
+}
+
+// returns false if the backend and the scalar definitions disagree
+static bool bench_math() {
+#if defined(TINYGIZMO_SIMD_SSE)
+  printf("math (TINYGIZMO_SIMD: SSE)\n");
+#elif defined(TINYGIZMO_SIMD_NEON)
+  printf("math (TINYGIZMO_SIMD: NEON)\n");
+#else
+  printf("math (scalar)\n");
+#endif
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  // small enough to stay in cache, so the timing is the math
+  const size_t count = 1024;
+  const size_t rounds = 100;
+  std::vector<Float4x4> matrices(count);
+  std::vector<Quaternion> quaternions(count);
+  std::vector<Float4> vectors(count);
+  for (size_t i = 0; i < count; ++i) {
+    float *m = &matrices[i].m00;
+    for (int j = 0; j < 16; ++j) {
+      m[j] = unit(rng) * 10;
+    }
+    quaternions[i] = Quaternion::from_axis_angle(
+        Float3{unit(rng), unit(rng), unit(rng) + 2}.normalize(), unit(rng) * 3);
+    vectors[i] = {unit(rng), unit(rng), unit(rng), 1};
+  }
+
+  float mul_error = 0;
+  float transform_error = 0;
+  float rotate_error = 0;
+  for (size_t i = 0; i + 1 < count; ++i) {
+    auto a = matrices[i] * matrices[i + 1];
+    auto b = mul_reference(matrices[i], matrices[i + 1]);
+    for (int j = 0; j < 16; ++j) {
+      mul_error = std::max(mul_error, std::abs((&a.m00)[j] - (&b.m00)[j]));
+    }
+    auto t = matrices[i].transform(vectors[i]);
+    auto u = transform_reference(matrices[i], vectors[i]);
+    transform_error =
+        std::max(transform_error, Float4{t.x - u.x, t.y - u.y, t.z - u.z,
+                                         t.w - u.w}
+                                      .length());
+    auto r = quaternions[i].rotate(vectors[i].xyz());
+    auto s = rotate_reference(quaternions[i], vectors[i].xyz());
+    rotate_error = std::max(rotate_error, (r - s).length());
+  }
+
+  float products = 0;
+  auto mul_ns = measure_ns(rounds * (count - 1), [&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i + 1 < count; ++i) {
+        auto m = matrices[i] * matrices[i + 1];
+        products += m.m00 + m.m13 + m.m21 + m.m32;
+      }
+    }
+  });
+  Float4 sum = {};
+  auto transform_ns = measure_ns(rounds * count, [&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < count; ++i) {
+        auto t = matrices[i].transform(vectors[i]);
+        sum = {sum.x + t.x, sum.y + t.y, sum.z + t.z, sum.w + t.w};
+      }
+    }
+  });
+  Float3 rotated = {};
+  auto rotate_ns = measure_ns(rounds * count, [&] {
+    for (size_t round = 0; round < rounds; ++round) {
+      for (size_t i = 0; i < count; ++i) {
+        rotated = rotated + quaternions[i].rotate(vectors[i].xyz());
+      }
+    }
+  });
+  printf("  Float4x4 * Float4x4 : %6.1f ns/op (max error %g)\n", mul_ns,
+         mul_error);
+  printf("  Float4x4::transform : %6.1f ns/op (max error %g)\n", transform_ns,
+         transform_error);
+  printf("  Quaternion::rotate  : %6.1f ns/op (max error %g)\n", rotate_ns,
+         rotate_error);
+  // keep the results alive
+  printf("  (%g %g %g)\n", products, sum.x, rotated.x);
+  // both sum in the same order, so only a contracted multiply-add may differ
+  const float tolerance = 1e-4f;
+  return mul_error <= tolerance && transform_error <= tolerance &&
+         rotate_error <= tolerance;
+}
+
+// PickMode::Analytic against the finest mesh level. A ray agrees if both
+// miss, or both hit the same component at the same t. The rest are rays
+// through the chord error of the 64 slices, at the silhouette edges.
+template <typename INTERSECT>
+static bool check_analytic(const char *name, const INTERSECT &intersect) {
+  // large enough to select the last level
+  const float finest = 1e6f;
+  const float epsilon = 0.01f;
+  auto rays = make_rays(100000, 1.3f);
+
+  using Result = decltype(intersect(rays[0], finest, PickMode::Mesh));
+  std::vector<Result> mesh(rays.size());
+  std::vector<Result> analytic(rays.size());
+  auto mesh_ns = measure_ns(rays.size(), [&] {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      mesh[i] = intersect(rays[i], finest, PickMode::Mesh);
+    }
+  });
+  auto analytic_ns = measure_ns(rays.size(), [&] {
+    for (size_t i = 0; i < rays.size(); ++i) {
+      analytic[i] = intersect(rays[i], 0, PickMode::Analytic);
+    }
+  });
+
+  size_t hits = 0;
+  size_t agree = 0;
+  for (size_t i = 0; i < rays.size(); ++i) {
+    auto [mesh_component, mesh_t] = mesh[i];
+    auto [analytic_component, analytic_t] = analytic[i];
+    if (!mesh_component && !analytic_component) {
+      continue;
+    }
+    ++hits;
+    if (mesh_component == analytic_component &&
+        std::abs(mesh_t - analytic_t) < epsilon) {
+      ++agree;
+    }
+  }
+  auto ratio = hits ? static_cast<double>(agree) / hits : 1.0;
+  printf("  %-11s: mesh %6.1f ns/ray, analytic %6.1f ns/ray, %zu/%zu agree "
+         "(%.2f%%)\n",
+         name, mesh_ns, analytic_ns, agree, hits, ratio * 100);
+  return ratio > 0.97;
+}
+
+static bool check_analytic() {
+  printf("analytic picking vs %zu slice meshes\n", LOD_SLICES[LOD_COUNT - 1]);
+  bool ok = true;
+  ok &= check_analytic("translation", [](const Ray &ray, float pixels,
+                                         PickMode mode) {
+    return position_intersect(ray, pixels, mode);
+  });
+  ok &= check_analytic("rotation", [](const Ray &ray, float pixels,
+                                      PickMode mode) {
+    return rotation_intersect(ray, pixels, mode);
+  });
+  ok &= check_analytic("scaling", [](const Ray &ray, float pixels,
+                                     PickMode mode) {
+    return scaling_intersect(ray, pixels, mode);
+  });
+  return ok;
+}
+
+// the gizmos are namespaces. wrap them so that one template drives all three
+#define GIZMO_API(GIZMO)                                                       \
+  struct GIZMO##Api {                                                          \
+    using GizmoComponentType = GIZMO::GizmoComponentType;                      \
+    static constexpr auto intersect = &GIZMO::intersect;                       \
+    static constexpr auto intersect_many = &GIZMO::intersect_many;             \
+    static constexpr auto drag = &GIZMO::drag;                                 \
+    static constexpr void (*mesh_triangles)(                                   \
+        const Float4x4 &, const AddTriangleRef &,                              \
+        std::optional<GizmoComponentType>, float) = &GIZMO::mesh;              \
+    static constexpr void (*mesh_components)(                                  \
+        const Float4x4 &, const AddMeshRef &,                                  \
+        std::optional<GizmoComponentType>, float) = &GIZMO::mesh;              \
+  };
+GIZMO_API(TranslationGizmo)
+GIZMO_API(RotationGizmo)
+GIZMO_API(ScalingGizmo)
+#undef GIZMO_API
+
+// one frame of picking, dragging and mesh emission for every gizmo
+template <typename GIZMO, typename... UNIFORM>
+static size_t gizmo_frame(const FrameState &frame,
+                          std::span<const Transform> targets,
+                          UNIFORM... uniform) {
+  size_t emitted = 0;
+  auto add_triangle = [&emitted](const Float4 &, const Float3 &,
+                                 const Float3 &, const Float3 &) {
+    ++emitted;
+  };
+  auto add_mesh = [&emitted](const Float4x4 &, const MeshComponent &mesh) {
+    emitted += mesh.triangles.size();
+  };
+
+  auto hit = GIZMO::intersect(frame, false, targets[0], uniform...);
+  auto many = GIZMO::intersect_many(frame, false, targets, uniform..., 1u);
+  std::optional<typename GIZMO::GizmoComponentType> active;
+  if (hit) {
+    auto [ray_state, component] = *hit;
+    active = component;
+    auto dragged = GIZMO::drag(component, frame, ray_state, targets[0]);
+    emitted += dragged.position.x != 0;
+  }
+  if (many) {
+    emitted += std::get<2>(*many);
+  }
+  auto model = targets[0].matrix();
+  auto pixels_per_unit = frame.pixels_per_unit(targets[0].position);
+  GIZMO::mesh_triangles(model, add_triangle, active, pixels_per_unit);
+  GIZMO::mesh_components(model, add_mesh, active, pixels_per_unit);
+  return emitted;
+}
+
+// returns false if a frame allocated
+static bool check_allocations() {
+  FrameState frame{
+      .mouse_down = true,
+      .viewport_size = {1280, 720},
+      .ray = {{0.3f, 0.2f, 5.0f}, Float3{0.2f, 0.1f, -5.0f}.normalize()},
+      .cam_yfov = 1.0f,
+      .cam_orientation = {0, 0, 0, 1},
+  };
+  std::vector<Transform> targets;
+  for (int i = 0; i < 100; ++i) {
+    targets.push_back({.position = {(i % 10) * 3.0f - 15.0f,
+                                    (i / 10) * 3.0f - 15.0f, 0}});
+  }
+  targets[0].position = {};
+
+  auto frames = [&]() {
+    size_t emitted = 0;
+    emitted += gizmo_frame<TranslationGizmoApi>(frame, targets);
+    emitted += gizmo_frame<RotationGizmoApi>(frame, targets);
+    emitted += gizmo_frame<ScalingGizmoApi>(frame, targets, false);
+    return emitted;
+  };
+  // warm up. function local statics and the like
+  frames();
+
+  auto before = g_allocations.load();
+  auto emitted = frames();
+  auto allocations = g_allocations.load() - before;
+  printf("allocations per gizmo frame (intersect, intersect_many, drag, "
+         "mesh)\n");
+  printf("  %zu allocations (%zu emitted)\n", allocations, emitted);
+  return allocations == 0;
+}
+
+// synthetic scene: targets on a grid with random orientations, seen from a
+// camera on +z. the rays aim near random targets, so some hit and some miss
+struct GizmoScene {
+  FrameState frame;
+  std::vector<Transform> targets;
+  std::vector<Ray> rays;
+
+  static GizmoScene make(size_t target_count, size_t ray_count) {
+    std::mt19937 rng(target_count);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    GizmoScene scene;
+    const float spacing = 3.0f;
+    size_t side = 1;
+    while (side * side * side < target_count) {
+      ++side;
+    }
+    const float half = (side - 1) * spacing * 0.5f;
+    for (size_t i = 0; i < target_count; ++i) {
+      Float3 axis{unit(rng), unit(rng), unit(rng)};
+      scene.targets.push_back({
+          .orientation = Quaternion::from_axis_angle(
+              axis.length2() > 0 ? axis.normalize() : Float3{0, 0, 1},
+              unit(rng) * 3.14f),
+          .position = {(i % side) * spacing - half,
+                       (i / side % side) * spacing - half,
+                       (i / side / side) * spacing - half},
+      });
+    }
+
+    const Float3 eye = {0, 0, half + 10.0f};
+    for (size_t i = 0; i < ray_count; ++i) {
+      auto &target = scene.targets[rng() % target_count].position;
+      auto aim = target + Float3{unit(rng), unit(rng), unit(rng)};
+      scene.rays.push_back({eye, (aim - eye).normalize()});
+    }
+    scene.frame = {
+        .mouse_down = true,
+        .viewport_size = {1280, 720},
+        .ray = scene.rays[0],
+        .cam_yfov = 1.0f,
+        .cam_orientation = {0, 0, 0, 1},
+    };
+    return scene;
+  }
+};
+
+struct SuiteResult {
+  double ns = 0;
+  size_t ops = 0;
+  size_t allocations = 0;
+  size_t triangles = 0;
+
+  template <typename F> void measure(size_t count, const F &f) {
+    auto before = g_allocations.load();
+    this->ns = measure_ns(count ? count : 1, f);
+    this->allocations = g_allocations.load() - before;
+    this->ops = count;
+  }
+
+  double allocations_per_op() const {
+    return this->ops ? static_cast<double>(this->allocations) / this->ops : 0;
+  }
+};
+
+// one row: every public entry point of one gizmo over one scene.
+// intersect is the per target loop a caller writes by hand, intersect_many
+// the batched call. both are per ray. drag is per hit, mesh per frame.
+// returns false if intersect_many picks another target, component or t than
+// the loop
+template <typename GIZMO, typename... UNIFORM>
+static bool bench_gizmo(const char *name, GizmoScene &scene, size_t &checksum,
+                        UNIFORM... uniform) {
+  auto &frame = scene.frame;
+  auto &targets = scene.targets;
+
+  // the nearest hit of each ray. index SIZE_MAX for a miss
+  struct Pick {
+    size_t index = SIZE_MAX;
+    typename GIZMO::GizmoComponentType component = {};
+    float t = 0;
+  };
+  std::vector<Pick> expected(scene.rays.size());
+  std::vector<Pick> actual(scene.rays.size());
+
+  struct Hit {
+    RayState ray_state;
+    typename GIZMO::GizmoComponentType component;
+    size_t index;
+  };
+  std::vector<Hit> hits;
+  hits.reserve(scene.rays.size());
+
+  SuiteResult intersect;
+  intersect.measure(scene.rays.size(), [&] {
+    for (size_t r = 0; r < scene.rays.size(); ++r) {
+      frame.ray = scene.rays[r];
+      float best_t = std::numeric_limits<float>::infinity();
+      for (size_t i = 0; i < targets.size(); ++i) {
+        if (auto hit = GIZMO::intersect(frame, true, targets[i], uniform...)) {
+          if (std::get<0>(*hit).t < best_t) {
+            best_t = std::get<0>(*hit).t;
+            expected[r] = {i, std::get<1>(*hit), best_t};
+          }
+        }
+      }
+    }
+  });
+
+  SuiteResult many;
+  many.measure(scene.rays.size(), [&] {
+    for (size_t r = 0; r < scene.rays.size(); ++r) {
+      frame.ray = scene.rays[r];
+      if (auto hit =
+              GIZMO::intersect_many(frame, true, targets, uniform..., 1u)) {
+        auto [ray_state, component, index] = *hit;
+        actual[r] = {index, component, ray_state.t};
+        hits.push_back({ray_state, component, index});
+      }
+    }
+  });
+
+  size_t mismatch = 0;
+  for (size_t r = 0; r < scene.rays.size(); ++r) {
+    auto &e = expected[r];
+    auto &a = actual[r];
+    if (e.index != a.index || (e.index != SIZE_MAX &&
+                               (e.component != a.component ||
+                                std::abs(e.t - a.t) > 1e-4f))) {
+      ++mismatch;
+    }
+  }
+
+  // move each hit ray a little, as the next frames of a drag would
+  SuiteResult drag;
+  drag.measure(hits.size(), [&] {
+    for (auto &hit : hits) {
+      frame.ray = hit.ray_state.local_ray.transform(
+          hit.ray_state.gizmo_transform);
+      frame.ray.origin = frame.ray.origin + Float3{0.05f, 0.03f, 0};
+      auto dragged = GIZMO::drag(hit.component, frame, hit.ray_state,
+                                 targets[hit.index]);
+      checksum += dragged.position.x > 0;
+    }
+  });
+
+  SuiteResult mesh;
+  size_t triangles = 0;
+  auto add_mesh = [&triangles](const Float4x4 &, const MeshComponent &mesh) {
+    triangles += mesh.triangles.size();
+  };
+  frame.ray = scene.rays[0];
+  mesh.measure(1, [&] {
+    for (auto &target : targets) {
+      auto [draw_scale, gizmo_transform, local_ray] =
+          frame.gizmo_transform_and_local_ray(true, target);
+      GIZMO::mesh_components(
+          gizmo_transform.matrix() *
+              Float4x4::scaling(draw_scale, draw_scale, draw_scale),
+          add_mesh, std::nullopt, frame.pixels_per_unit(target.position));
+    }
+  });
+  mesh.triangles = triangles;
+
+  SuiteResult mesh_triangles;
+  size_t emitted = 0;
+  auto add_triangle = [&emitted](const Float4 &, const Float3 &,
+                                 const Float3 &, const Float3 &) {
+    ++emitted;
+  };
+  mesh_triangles.measure(1, [&] {
+    for (auto &target : targets) {
+      auto [draw_scale, gizmo_transform, local_ray] =
+          frame.gizmo_transform_and_local_ray(true, target);
+      GIZMO::mesh_triangles(
+          gizmo_transform.matrix() *
+              Float4x4::scaling(draw_scale, draw_scale, draw_scale),
+          add_triangle, std::nullopt, frame.pixels_per_unit(target.position));
+    }
+  });
+  mesh_triangles.triangles = emitted;
+
+  auto allocations = intersect.allocations_per_op() +
+                     many.allocations_per_op() + drag.allocations_per_op() +
+                     mesh.allocations_per_op() +
+                     mesh_triangles.allocations_per_op();
+  printf("  %-11s %5zu | %10.0f %10.0f | %7.1f (%3zu) | %10.0f %10.0f "
+         "%8zu | %g%s\n",
+         name, targets.size(), intersect.ns, many.ns, drag.ns, hits.size(),
+         mesh.ns, mesh_triangles.ns, mesh_triangles.triangles, allocations,
+         mismatch ? " MISMATCH" : "");
+  return mismatch == 0;
+}
+
+static bool bench_gizmos() {
+  printf("gizmo suite, ns/op. intersect and intersect_many per ray, drag per "
+         "hit, mesh per frame\n");
+  printf("  %-11s %5s | %10s %10s | %13s | %10s %10s %8s | %s\n", "gizmo",
+         "n", "intersect", "many", "drag (hits)", "add_mesh", "add_tri",
+         "tris", "allocs/op");
+  const size_t ray_count = 32;
+  size_t checksum = 0;
+  bool same = true;
+  for (size_t target_count : {1, 10, 100, 1000, 10000}) {
+    auto scene = GizmoScene::make(target_count, ray_count);
+    same &= bench_gizmo<TranslationGizmoApi>("translation", scene, checksum);
+    same &= bench_gizmo<RotationGizmoApi>("rotation", scene, checksum);
+    same &= bench_gizmo<ScalingGizmoApi>("scaling", scene, checksum, false);
+  }
+  // keep the results alive
+  printf("  (%zu)\n", checksum);
+  return same;
+}
+
+// the largest difference between two transforms, over every component
+static float transform_error(const Transform &a, const Transform &b) {
+  auto &q = a.orientation;
+  auto &r = b.orientation;
+  return std::max({std::abs(q.x - r.x), std::abs(q.y - r.y),
+                   std::abs(q.z - r.z), std::abs(q.w - r.w),
+                   (a.position - b.position).length(),
+                   (a.scale - b.scale).length()});
+}
+
+// a selection dragged by the translation gizmo. naive calls drag once per
+// member, group calls it once and applies the delta with GroupDrag. returns
+// false if the group result is not the naive one
+static bool bench_group() {
+  printf("group drag, ns per member\n");
+  bool same = true;
+  for (size_t count : {5000, 50000}) {
+    auto scene = GizmoScene::make(count, 1);
+    auto &frame = scene.frame;
+    auto &targets = scene.targets;
+    // grab the x arrow of the first target, then move the mouse a little
+    auto &active = targets[0];
+    frame.ray = {{active.position.x + 0.6f, active.position.y + 1.0f,
+                  active.position.z + 5.0f},
+                 {0, -1.0f, -5.0f}};
+    frame.ray.direction = frame.ray.direction.normalize();
+    auto hit = TranslationGizmo::intersect(frame, false, active);
+    if (!hit) {
+      printf("  no hit\n");
+      same = false;
+      continue;
+    }
+    auto [ray_state, component] = *hit;
+    frame.ray.origin = frame.ray.origin + Float3{0.3f, 0, 0};
+
+    // each member dragged as if it had its own gizmo, picked at the same
+    // point: the ray and the drag plane move by its offset from the active
+    std::vector<Transform> dst(count);
+    const auto origin = frame.ray.origin;
+    auto naive = measure_ns(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        auto offset = targets[i].position - active.position;
+        auto state = ray_state;
+        state.transform = targets[i];
+        state.cache.plane.d -= Float3::dot(state.cache.plane.normal, offset);
+        frame.ray.origin = origin + offset;
+        dst[i] = TranslationGizmo::drag(component, frame, state, targets[i]);
+      }
+    });
+    frame.ray.origin = origin;
+
+    auto expected = dst;
+    auto error = [&] {
+      float max_error = 0;
+      for (size_t i = 0; i < count; ++i) {
+        max_error = std::max(max_error, transform_error(expected[i], dst[i]));
+      }
+      return max_error;
+    };
+
+    GroupDrag group;
+    group.begin(targets, active);
+    auto one = measure_ns(count, [&] {
+      group.apply(TranslationGizmo::drag(component, frame, ray_state, active),
+                  dst);
+    });
+    auto one_error = error();
+    const unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    auto parallel = measure_ns(count, [&] {
+      group.apply(TranslationGizmo::drag(component, frame, ray_state, active),
+                  dst, threads);
+    });
+    auto parallel_error = error();
+    // the group adds one delta, the naive drag projects each member again
+    const float tolerance = 1e-3f;
+    same = same && one_error <= tolerance && parallel_error <= tolerance;
+    printf("  %6zu members: naive %6.1f, group %6.1f, group x%u %6.1f "
+           "(moved %g, max error %g, %g)\n",
+           count, naive, one, threads, parallel,
+           dst[count - 1].position.x - targets[count - 1].position.x,
+           one_error, parallel_error);
+  }
+  return same;
+}
+
+// a uv sphere of radius 1 with about count vertices
+static void make_sphere(size_t count, std::vector<Float3> &positions,
+                        std::vector<uint32_t> &indices) {
+  const auto side = static_cast<uint32_t>(std::sqrt(count));
+  const float pi = 3.14159265f;
+  positions.clear();
+  indices.clear();
+  for (uint32_t i = 0; i < side; ++i) {
+    float theta = pi * (i + 0.5f) / side;
+    for (uint32_t j = 0; j < side; ++j) {
+      float phi = 2 * pi * j / side;
+      positions.push_back({std::sin(theta) * std::cos(phi), std::cos(theta),
+                           std::sin(theta) * std::sin(phi)});
+    }
+  }
+  for (uint32_t i = 0; i + 1 < side; ++i) {
+    for (uint32_t j = 0; j < side; ++j) {
+      uint32_t a = i * side + j;
+      uint32_t b = i * side + (j + 1) % side;
+      uint32_t c = a + side;
+      uint32_t d = b + side;
+      indices.insert(indices.end(), {a, c, b, b, c, d});
+    }
+  }
+}
+
+// vertex and surface snapping near a sphere. the reference is the same
+// index with one cell around everything, which tests every vertex
+static bool bench_snap() {
+  printf("snap index, ns per query (radius 0.05 around a unit sphere)\n");
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  bool same = true;
+  for (size_t count : {10000, 100000, 1000000}) {
+    std::vector<Float3> positions;
+    std::vector<uint32_t> indices;
+    make_sphere(count, positions, indices);
+
+    SnapIndex index;
+    auto build_ns = measure_ns(positions.size(),
+                               [&] { index.build(positions, indices); });
+    SnapIndex reference;
+    reference.build(positions, indices, 100);
+
+    const size_t queries = count >= 1000000 ? 100 : 1000;
+    std::vector<Float3> points;
+    for (size_t i = 0; i < queries; ++i) {
+      auto n = Float3{unit(rng), unit(rng), unit(rng)}.normalize();
+      points.push_back(n.scale(1 + 0.05f * unit(rng)));
+    }
+    auto vertex_ns = [&](const SnapIndex &index, std::vector<float> &d) {
+      d.clear();
+      return measure_ns(queries, [&] {
+        for (auto &p : points) {
+          auto hit = index.nearest_vertex(p, 0.05f);
+          d.push_back(hit ? (*hit - p).length2() : -1);
+        }
+      });
+    };
+    auto surface_ns = [&](const SnapIndex &index, std::vector<float> &d) {
+      d.clear();
+      return measure_ns(queries, [&] {
+        for (auto &p : points) {
+          auto hit = index.nearest_surface(p, 0.05f);
+          d.push_back(hit ? (*hit - p).length2() : -1);
+        }
+      });
+    };
+    std::vector<float> a, b, c, d;
+    auto vertex = vertex_ns(index, a);
+    auto vertex_scan = vertex_ns(reference, b);
+    auto surface = surface_ns(index, c);
+    auto surface_scan = surface_ns(reference, d);
+    same = same && a == b && c == d;
+    printf("  %7zu vertices: build %5.1f ns/vertex, vertex %7.1f (scan "
+           "%10.1f), surface %7.1f (scan %10.1f) (%s)\n",
+           positions.size(), build_ns, vertex, vertex_scan, surface,
+           surface_scan, a == b && c == d ? "same" : "MISMATCH");
+  }
+  return same;
+}
+
+// a scene of boxes in the AabbTree against a linear scan over the boxes,
+// the way the example picked before it had a tree
+static bool bench_aabbtree() {
+  printf("aabb tree, ns per query\n");
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  bool same = true;
+  for (size_t count : {1000, 100000}) {
+    // about one object per unit cube
+    const float extent = std::cbrt(static_cast<float>(count)) / 2;
+    std::vector<AABB> boxes(count);
+    for (auto &box : boxes) {
+      Float3 c = Float3{unit(rng), unit(rng), unit(rng)}.scale(extent);
+      box = {c - Float3{0.3f, 0.3f, 0.3f}, c + Float3{0.3f, 0.3f, 0.3f}};
+    }
+    AabbTree tree;
+    std::vector<uint32_t> proxies(count);
+    auto build = measure_ns(count, [&] {
+      for (size_t i = 0; i < count; ++i) {
+        proxies[i] = tree.insert(boxes[i], static_cast<uint32_t>(i));
+      }
+    });
+
+    const size_t queries = 1000;
+    std::vector<Ray> rays;
+    std::vector<Float3> points;
+    for (size_t i = 0; i < queries; ++i) {
+      Float3 origin = {unit(rng) * extent, unit(rng) * extent, extent * 2};
+      Float3 target = Float3{unit(rng), unit(rng), unit(rng)}.scale(extent);
+      rays.push_back({origin, (target - origin).normalize()});
+      points.push_back(Float3{unit(rng), unit(rng), unit(rng)}.scale(extent));
+    }
+
+    // the exact test of a leaf is its box, as a mesh would be
+    std::vector<float> a, b, c, d;
+    auto pick = measure_ns(queries, [&] {
+      for (auto &ray : rays) {
+        float best = std::numeric_limits<float>::infinity();
+        tree.raycast(ray, best, [&](uint32_t item, float max_t) {
+          float t;
+          if (ray.intersect_aabb(boxes[item], &t) && t < max_t) {
+            best = t;
+            return t;
+          }
+          return max_t;
+        });
+        a.push_back(best);
+      }
+    });
+    auto pick_scan = measure_ns(queries, [&] {
+      for (auto &ray : rays) {
+        float best = std::numeric_limits<float>::infinity();
+        for (auto &box : boxes) {
+          float t;
+          if (ray.intersect_aabb(box, &t) && t < best) {
+            best = t;
+          }
+        }
+        b.push_back(best);
+      }
+    });
+    auto nearest = measure_ns(queries, [&] {
+      for (auto &p : points) {
+        float best = std::numeric_limits<float>::infinity();
+        tree.nearest(p, best, [&](uint32_t item, float max_distance) {
+          best = std::min(max_distance, AabbTree::distance(boxes[item], p));
+          return best;
+        });
+        c.push_back(best);
+      }
+    });
+    auto nearest_scan = measure_ns(queries, [&] {
+      for (auto &p : points) {
+        float best = std::numeric_limits<float>::infinity();
+        for (auto &box : boxes) {
+          best = std::min(best, AabbTree::distance(box, p));
+        }
+        d.push_back(best);
+      }
+    });
+    same = same && a == b && c == d;
+
+    // a narrow view down -z from above the scene
+    const Float3 eye = {0, 0, extent * 2};
+    const Plane frustum[] = {
+        Plane::from_normal_and_position({1, 0, -0.2f}, eye),
+        Plane::from_normal_and_position({-1, 0, -0.2f}, eye),
+        Plane::from_normal_and_position({0, 1, -0.2f}, eye),
+        Plane::from_normal_and_position({0, -1, -0.2f}, eye),
+    };
+    size_t visible = 0;
+    auto cull = measure_ns(100, [&] {
+      for (int i = 0; i < 100; ++i) {
+        visible = 0;
+        tree.frustum(frustum, [&](uint32_t) { ++visible; });
+      }
+    });
+
+    // a group drag of 1% of the objects, refit every frame
+    const size_t moving = count / 100;
+    auto refit = measure_ns(moving * 100, [&] {
+      for (int frame = 0; frame < 100; ++frame) {
+        Float3 step = {0.01f, 0, 0};
+        for (size_t i = 0; i < moving; ++i) {
+          boxes[i] = {boxes[i].min + step, boxes[i].max + step};
+          tree.move(proxies[i], boxes[i]);
+        }
+      }
+    });
+
+    printf("  %6zu boxes: insert %6.1f, pick %8.1f (scan %9.1f), nearest "
+           "%8.1f (scan %9.1f), frustum %9.0f for %zu, refit %5.1f, "
+           "height %d (%s)\n",
+           count, build, pick, pick_scan, nearest, nearest_scan, cull,
+           visible, refit, tree.height(),
+           a == b && c == d ? "same" : "MISMATCH");
+  }
+  return same;
+}
+
+int main(int argc, char **argv) {
+  if (!bench_ring_intersect()) {
+    return 1;
+  }
+  if (!bench_weld()) {
+    return 1;
+  }
+  if (!bench_math()) {
+    return 1;
+  }
+  if (!bench_gizmos()) {
+    return 1;
+  }
+  if (!bench_group()) {
+    return 1;
+  }
+  if (!bench_snap()) {
+    return 1;
+  }
+  if (!bench_aabbtree()) {
+    return 1;
+  }
+  if (!check_analytic()) {
+    return 1;
+  }
+  if (!check_allocations()) {
+    return 1;
+  }
+  return 0;
+}
@@ -49,6 +49,7 @@ IMGUI_IMPL_API void Imgui_ImplRaylib_BuildFontAtlas(void);
 IMGUI_IMPL_API void ImGui_ImplRaylib_Shutdown(void);
 IMGUI_IMPL_API void ImGui_ImplRaylib_NewFrame(void);
 IMGUI_IMPL_API void ImGui_ImplRaylib_RenderDrawData(ImDrawData* draw_data);
+// empties the raylib key queue, GetKeyPressed returns nothing after it
 IMGUI_IMPL_API bool ImGui_ImplRaylib_ProcessEvents(void);
 
 #endif // #ifndef IMGUI_DISABLE
@@ -30,12 +30,18 @@
 #include "rlImGui.h"
 
 #include "imgui_impl_raylib.h"
+#include "imgui_internal.h"
 
 #include "raylib.h"
+#include "raymath.h"
 #include "rlgl.h"
 
 #include <math.h>
-#include <map>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
 #include <limits>
 
 #ifndef NO_FONT_AWESOME
@@ -47,7 +53,10 @@ static MouseCursor MouseCursorMap[ImGuiMouseCursor_COUNT];
 
 ImGuiContext* GlobalContext = nullptr;
 
-static std::map<KeyboardKey, ImGuiKey> RaylibKeyMap;
+// by raylib key, ImGuiKey_None for the keys ImGui does not know
+static ImGuiKey RaylibKeyMap[KEY_KB_MENU + 1] = {};
+// the keys reported down to ImGui, to report them up again
+static std::vector<KeyboardKey> KeysDown;
 
 static bool LastFrameFocused = false;
 
@@ -56,33 +65,213 @@ static bool LastShiftPressed = false;
 static bool LastAltPressed = false;
 static bool LastSuperPressed = false;
 
+// the last frame, while the draw data stays the same
+static bool CacheUnchangedFrames = false;
+static RenderTexture2D CachedFrame = { 0 };
+static uint64_t CachedFrameHash = 0;
+static bool CachedFrameValid = false;
+
+static Texture2D* FontTexture = nullptr;
+
+// the rlgl default shader, with white as the color of a single channel font atlas
+static unsigned int AlphaFontShader = 0;
+static int AlphaFontShaderLocs[RL_MAX_SHADER_LOCATIONS] = {};
+
+// only the glyphs that were asked for are put in the font atlas
+static bool DynamicGlyphs = false;
+static bool DynamicGlyphsDirty = false;
+static ImFontGlyphRangesBuilder RequestedGlyphs;
+// by font config, the ranges the font was added with and the ones it is built with
+struct DynamicGlyphRanges
+{
+    const ImWchar* Source = nullptr;
+    std::vector<ImWchar> Ranges;
+};
+static std::vector<DynamicGlyphRanges> FontGlyphRanges;
+
 bool rlImGuiIsControlDown() { return IsKeyDown(KEY_RIGHT_CONTROL) || IsKeyDown(KEY_LEFT_CONTROL); }
 bool rlImGuiIsShiftDown() { return IsKeyDown(KEY_RIGHT_SHIFT) || IsKeyDown(KEY_LEFT_SHIFT); }
 bool rlImGuiIsAltDown() { return IsKeyDown(KEY_RIGHT_ALT) || IsKeyDown(KEY_LEFT_ALT); }
 bool rlImGuiIsSuperDown() { return IsKeyDown(KEY_RIGHT_SUPER) || IsKeyDown(KEY_LEFT_SUPER); }
 
+static void RequestGlyph(unsigned int codepoint)
+{
+    if (codepoint > IM_UNICODE_CODEPOINT_MAX || RequestedGlyphs.GetBit(codepoint))
+        return;
+    RequestedGlyphs.SetBit(codepoint);
+    DynamicGlyphsDirty |= DynamicGlyphs;
+}
+
+// points the font configs at ranges that only hold the requested glyphs
+static void BuildDynamicGlyphRanges(ImFontAtlas* atlas)
+{
+    FontGlyphRanges.resize(atlas->ConfigData.Size);
+    for (int i = 0; i < atlas->ConfigData.Size; ++i)
+    {
+        ImFontConfig& config = atlas->ConfigData[i];
+        DynamicGlyphRanges& glyphs = FontGlyphRanges[i];
+        if (glyphs.Ranges.empty() || config.GlyphRanges != glyphs.Ranges.data())
+            glyphs.Source = config.GlyphRanges ? config.GlyphRanges : atlas->GetGlyphRangesDefault();
+
+        glyphs.Ranges.clear();
+        for (const ImWchar* range = glyphs.Source; range[0] != 0; range += 2)
+        {
+            unsigned int first = range[0];
+            unsigned int last = range[1];
+            // Latin-1, and icon fonts in the private use area, are small enough to keep whole
+            if (first >= 0xE000 && last <= 0xF8FF)
+            {
+                glyphs.Ranges.push_back(ImWchar(first));
+                glyphs.Ranges.push_back(ImWchar(last));
+                continue;
+            }
+            if (first <= 0xFF)
+            {
+                glyphs.Ranges.push_back(ImWchar(first));
+                glyphs.Ranges.push_back(ImWchar(ImMin(last, 0xFFu)));
+                first = 0x100;
+            }
+            for (unsigned int codepoint = first; codepoint <= last; ++codepoint)
+            {
+                if (!RequestedGlyphs.GetBit(codepoint))
+                    continue;
+                if (!glyphs.Ranges.empty() && glyphs.Ranges.back() + 1u == codepoint)
+                {
+                    glyphs.Ranges.back() = ImWchar(codepoint);
+                }
+                else
+                {
+                    glyphs.Ranges.push_back(ImWchar(codepoint));
+                    glyphs.Ranges.push_back(ImWchar(codepoint));
+                }
+            }
+        }
+        glyphs.Ranges.push_back(0);
+        config.GlyphRanges = glyphs.Ranges.data();
+    }
+}
+
+static void RestoreGlyphRanges(ImFontAtlas* atlas)
+{
+    for (int i = 0; i < atlas->ConfigData.Size && i < int(FontGlyphRanges.size()); ++i)
+    {
+        if (atlas->ConfigData[i].GlyphRanges == FontGlyphRanges[i].Ranges.data())
+            atlas->ConfigData[i].GlyphRanges = FontGlyphRanges[i].Source;
+    }
+    FontGlyphRanges.clear();
+}
+
+static const char AlphaFontVS[] = R"(#version 330
+in vec3 vertexPosition;
+in vec2 vertexTexCoord;
+in vec4 vertexColor;
+out vec2 fragTexCoord;
+out vec4 fragColor;
+uniform mat4 mvp;
+void main()
+{
+    fragTexCoord = vertexTexCoord;
+    fragColor = vertexColor;
+    gl_Position = mvp*vec4(vertexPosition, 1.0);
+}
+)";
+
+// raylib reads a grayscale texture as { r, r, r, 1 }
+static const char AlphaFontFS[] = R"(#version 330
+in vec2 fragTexCoord;
+in vec4 fragColor;
+out vec4 finalColor;
+uniform sampler2D texture0;
+uniform vec4 colDiffuse;
+void main()
+{
+    finalColor = vec4(1.0, 1.0, 1.0, texture(texture0, fragTexCoord).r)*colDiffuse*fragColor;
+}
+)";
+
+static bool LoadAlphaFontShader(void)
+{
+    if (AlphaFontShader != 0)
+        return true;
+    // rlgl binds the default attribute names to the locations of the default shader
+    unsigned int id = rlLoadShaderCode(AlphaFontVS, AlphaFontFS);
+    if (id == 0 || id == rlGetShaderIdDefault())
+        return false;
+    AlphaFontShader = id;
+    AlphaFontShaderLocs[RL_SHADER_LOC_MATRIX_MVP] = rlGetLocationUniform(id, "mvp");
+    AlphaFontShaderLocs[RL_SHADER_LOC_COLOR_DIFFUSE] = rlGetLocationUniform(id, "colDiffuse");
+    AlphaFontShaderLocs[RL_SHADER_LOC_MAP_DIFFUSE] = rlGetLocationUniform(id, "texture0");
+    return true;
+}
+
+static void UnloadAlphaFontShader(void)
+{
+    if (AlphaFontShader != 0)
+        rlUnloadShaderProgram(AlphaFontShader);
+    AlphaFontShader = 0;
+}
+
+// the atlas is coverage only, unless a custom rect has colors. a single channel texture is a quarter
+// of the size, and AlphaFontShader reads it as white with the coverage as alpha
+static bool UseAlpha8FontTexture(const ImFontAtlas* atlas)
+{
+    int version = rlGetVersion();
+    if (atlas->TexPixelsUseColors || (version != RL_OPENGL_33 && version != RL_OPENGL_43))
+        return false;
+    return LoadAlphaFontShader();
+}
+
+static bool IsAlpha8FontTexture(const Texture* texture)
+{
+    return texture != nullptr && texture == FontTexture && texture->format == PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+}
+
 void ReloadFonts(void)
 {
     ImGuiIO& io = ImGui::GetIO();
-    unsigned char* pixels = nullptr;
+    if (DynamicGlyphs)
+        BuildDynamicGlyphRanges(io.Fonts);
+    DynamicGlyphsDirty = false;
 
+    // build again, for fonts or glyphs added since the last build
+    io.Fonts->Build();
+
+    unsigned char* pixels = nullptr;
     int width;
     int height;
-    io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height, nullptr);
-    Image image = GenImageColor(width, height, BLANK);
-    memcpy(image.data, pixels, width * height * 4);
+    int format;
+    bool alpha8 = UseAlpha8FontTexture(io.Fonts);
+    if (alpha8)
+    {
+        io.Fonts->GetTexDataAsAlpha8(&pixels, &width, &height, nullptr);
+        format = PIXELFORMAT_UNCOMPRESSED_GRAYSCALE;
+    }
+    else
+    {
+        io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height, nullptr);
+        format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+    }
 
-    Texture2D* fontTexture = (Texture2D*)io.Fonts->TexID;
-    if (fontTexture && fontTexture->id != 0)
+    // the glyphs move when the atlas is built again, but the texture is reused while the size stays the same
+    if (FontTexture && FontTexture->id != 0 && FontTexture->width == width && FontTexture->height == height
+        && FontTexture->format == format)
     {
-        UnloadTexture(*fontTexture);
-        MemFree(fontTexture);
+        UpdateTexture(*FontTexture, pixels);
     }
+    else
+    {
+        if (FontTexture == nullptr)
+            FontTexture = (Texture2D*)MemAlloc(sizeof(Texture2D));
+        else if (FontTexture->id != 0)
+            UnloadTexture(*FontTexture);
 
-    fontTexture = (Texture2D*)MemAlloc(sizeof(Texture2D));
-    *fontTexture = LoadTextureFromImage(image);
-    UnloadImage(image);
-    io.Fonts->TexID = fontTexture;
+        Image image = { pixels, width, height, 1, format };
+        *FontTexture = LoadTextureFromImage(image);
+    }
+    io.Fonts->TexID = FontTexture;
+    // the texture has the pixels now
+    io.Fonts->ClearTexData();
+    CachedFrameValid = false;
 }
 
 static const char* GetClipTextCallback(void*) 
@@ -99,6 +288,9 @@ static void ImGuiNewFrame(float deltaTime)
 {
     ImGuiIO& io = ImGui::GetIO();
 
+    // the atlas can not change between NewFrame and Render
+    if (DynamicGlyphsDirty)
+        ReloadFonts();
 
     Vector2 resolutionScale = GetWindowScaleDPI();
 
@@ -182,50 +374,95 @@ static void ImGuiNewFrame(float deltaTime)
     }
 }
 
-static void ImGuiTriangleVert(ImDrawVert& idx_vert)
+// The draw lists go to gpu buffers that are kept from frame to frame and only grow.
+// Each frame writes all the lists in one pass, then draws each command as a range of the index buffer.
+static unsigned int DrawVao = 0;
+static unsigned int DrawVbo = 0;
+static unsigned int DrawIbo = 0;
+static int DrawVboSize = 0;
+static int DrawIboSize = 0;
+
+// rlDrawVertexArrayElements draws GL_UNSIGNED_SHORT
+static_assert(sizeof(ImDrawIdx) == sizeof(unsigned short), "ImDrawIdx must be 16 bit");
+
+static void ReserveDrawBuffers(int vtxSize, int idxSize)
 {
-    Color* c;
-    c = (Color*)&idx_vert.col;
-    rlColor4ub(c->r, c->g, c->b, c->a);
-    rlTexCoord2f(idx_vert.uv.x, idx_vert.uv.y);
-    rlVertex2f(idx_vert.pos.x, idx_vert.pos.y);
+    if (DrawVao == 0)
+        DrawVao = rlLoadVertexArray();
+
+    // the element buffer binding belongs to the vao
+    rlEnableVertexArray(DrawVao);
+
+    if (vtxSize > DrawVboSize)
+    {
+        rlUnloadVertexBuffer(DrawVbo);
+        DrawVboSize = std::max(vtxSize, DrawVboSize * 2);
+        DrawVbo = rlLoadVertexBuffer(nullptr, DrawVboSize, true);
+    }
+
+    if (idxSize > DrawIboSize)
+    {
+        rlUnloadVertexBuffer(DrawIbo);
+        DrawIboSize = std::max(idxSize, DrawIboSize * 2);
+        DrawIbo = rlLoadVertexBufferElement(nullptr, DrawIboSize, true);
+    }
 }
 
-static void ImGuiRenderTriangles(unsigned int count, int indexStart, const ImVector<ImDrawIdx>& indexBuffer, const ImVector<ImDrawVert>& vertBuffer, void* texturePtr)
+static void UnloadDrawBuffers(void)
 {
-    if (count < 3)
-        return;
-
-    Texture* texture = (Texture*)texturePtr;
+    rlUnloadVertexBuffer(DrawVbo);
+    rlUnloadVertexBuffer(DrawIbo);
+    rlUnloadVertexArray(DrawVao);
+    DrawVao = DrawVbo = DrawIbo = 0;
+    DrawVboSize = DrawIboSize = 0;
+}
 
-    unsigned int textureId = (texture == nullptr) ? 0 : texture->id;
+// the indices of a list start at its own first vertex
+static void SetupVertexAttributes(int firstVertex)
+{
+    int* locs = rlGetShaderLocsDefault();
+    size_t base = firstVertex * sizeof(ImDrawVert);
+
+    rlEnableVertexBuffer(DrawVbo);
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION], 2, RL_FLOAT, false, sizeof(ImDrawVert), (void*)(base + offsetof(ImDrawVert, pos)));
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_POSITION]);
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_TEXCOORD01], 2, RL_FLOAT, false, sizeof(ImDrawVert), (void*)(base + offsetof(ImDrawVert, uv)));
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_TEXCOORD01]);
+    rlSetVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR], 4, RL_UNSIGNED_BYTE, true, sizeof(ImDrawVert), (void*)(base + offsetof(ImDrawVert, col)));
+    rlEnableVertexAttribute(locs[RL_SHADER_LOC_VERTEX_COLOR]);
+}
 
-    rlBegin(RL_TRIANGLES);
-    rlSetTexture(textureId);
+// the matrices the batch would use
+static void SetupShader(unsigned int id, const int* locs)
+{
+    rlEnableShader(id);
 
-    for (unsigned int i = 0; i <= (count - 3); i += 3)
-    {
-        ImDrawIdx indexA = indexBuffer[indexStart + i];
-        ImDrawIdx indexB = indexBuffer[indexStart + i + 1];
-        ImDrawIdx indexC = indexBuffer[indexStart + i + 2];
+    Matrix mvp = MatrixMultiply(MatrixMultiply(rlGetMatrixTransform(), rlGetMatrixModelview()), rlGetMatrixProjection());
+    rlSetUniformMatrix(locs[RL_SHADER_LOC_MATRIX_MVP], mvp);
 
-        ImDrawVert vertexA = vertBuffer[indexA];
-        ImDrawVert vertexB = vertBuffer[indexB];
-        ImDrawVert vertexC = vertBuffer[indexC];
+    float white[4] = { 1, 1, 1, 1 };
+    rlSetUniform(locs[RL_SHADER_LOC_COLOR_DIFFUSE], white, RL_SHADER_UNIFORM_VEC4, 1);
 
-        ImGuiTriangleVert(vertexA);
-        ImGuiTriangleVert(vertexB);
-        ImGuiTriangleVert(vertexC);
-    }
-    rlEnd();
+    int slot = 0;
+    rlActiveTextureSlot(slot);
+    rlSetUniform(locs[RL_SHADER_LOC_MAP_DIFFUSE], &slot, RL_SHADER_UNIFORM_INT, 1);
 }
 
-static void EnableScissor(float x, float y, float width, float height)
+// the rlgl default shader
+static void SetupRenderState(int firstVertex)
 {
-    rlEnableScissorTest();
-    ImGuiIO& io = ImGui::GetIO();
+    rlDisableBackfaceCulling();
 
-    ImVec2 scale = io.DisplayFramebufferScale;
+    SetupShader(rlGetShaderIdDefault(), rlGetShaderLocsDefault());
+
+    rlEnableVertexArray(DrawVao);
+    rlEnableVertexBufferElement(DrawIbo);
+    SetupVertexAttributes(firstVertex);
+}
+
+static ImVec2 GetFramebufferScale(void)
+{
+    ImVec2 scale = ImGui::GetIO().DisplayFramebufferScale;
 #if !defined(__APPLE__)
     if (!IsWindowState(FLAG_WINDOW_HIGHDPI))
     {
@@ -233,6 +470,15 @@ static void EnableScissor(float x, float y, float width, float height)
         scale.y = 1;
     }
 #endif
+    return scale;
+}
+
+static void EnableScissor(float x, float y, float width, float height)
+{
+    rlEnableScissorTest();
+    ImGuiIO& io = ImGui::GetIO();
+
+    ImVec2 scale = GetFramebufferScale();
 
     rlScissor((int)(x * scale.x),
         int((io.DisplaySize.y - (int)(y + height)) * scale.y),
@@ -309,7 +555,7 @@ void rlImGuiEndInitImGui(void)
 
 static void SetupKeymap(void)
 {
-    if (!RaylibKeyMap.empty())
+    if (RaylibKeyMap[KEY_APOSTROPHE] != ImGuiKey_None)
         return;
 
     // build up a map of raylib keys to ImGuiKeys
@@ -427,6 +673,7 @@ static void SetupGlobals(void)
     LastShiftPressed = false;
     LastAltPressed = false;
     LastSuperPressed = false;
+    KeysDown.clear();
 }
 
 void rlImGuiBeginInitImGui(void)
@@ -459,6 +706,31 @@ void rlImGuiReloadFonts(void)
     ReloadFonts();
 }
 
+void rlImGuiSetDynamicGlyphs(bool enabled)
+{
+    ImGui::SetCurrentContext(GlobalContext);
+    if (enabled == DynamicGlyphs)
+        return;
+
+    DynamicGlyphs = enabled;
+    if (!enabled)
+        RestoreGlyphRanges(ImGui::GetIO().Fonts);
+    DynamicGlyphsDirty = true;
+}
+
+void rlImGuiAddGlyphs(const char* text)
+{
+    while (text && *text)
+    {
+        unsigned int codepoint = 0;
+        int length = ImTextCharFromUtf8(&codepoint, text, nullptr);
+        if (length == 0)
+            break;
+        RequestGlyph(codepoint);
+        text += length;
+    }
+}
+
 void rlImGuiBegin(void)
 {
     ImGui::SetCurrentContext(GlobalContext);
@@ -473,11 +745,127 @@ void rlImGuiBeginDelta(float deltaTime)
     ImGui::NewFrame();
 }
 
+// the splitmix64 finalizer
+static inline uint64_t MixHash(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// A hash over everything that ends up on screen, 8 bytes at a time. 0 when the frame can not be cached
+static uint64_t HashDrawData(const ImDrawData* draw_data)
+{
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    auto add = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = (const unsigned char*)data;
+            uint64_t word;
+            for (; size >= sizeof(word); size -= sizeof(word), bytes += sizeof(word))
+            {
+                memcpy(&word, bytes, sizeof(word));
+                hash = MixHash(hash ^ word);
+            }
+            // the rest, with its length in the top byte
+            word = 0;
+            memcpy(&word, bytes, size);
+            hash = MixHash(hash ^ word ^ (uint64_t(size) << 56));
+        };
+
+    ImTextureID fontTexture = ImGui::GetIO().Fonts->TexID;
+    add(&draw_data->DisplayPos, sizeof(draw_data->DisplayPos));
+    add(&draw_data->DisplaySize, sizeof(draw_data->DisplaySize));
+    for (int l = 0; l < draw_data->CmdListsCount; ++l)
+    {
+        const ImDrawList* commandList = draw_data->CmdLists[l];
+        add(commandList->VtxBuffer.Data, commandList->VtxBuffer.size_in_bytes());
+        add(commandList->IdxBuffer.Data, commandList->IdxBuffer.size_in_bytes());
+        for (const auto& cmd : commandList->CmdBuffer)
+        {
+            if (cmd.UserCallback != nullptr || (cmd.TextureId != fontTexture && cmd.TextureId != nullptr))
+                return 0;
+            add(&cmd.ClipRect, sizeof(cmd.ClipRect));
+            add(&cmd.IdxOffset, sizeof(cmd.IdxOffset));
+            add(&cmd.ElemCount, sizeof(cmd.ElemCount));
+        }
+    }
+    return hash == 0 ? 1 : hash;
+}
+
+static void UnloadCachedFrame(void)
+{
+    if (CachedFrame.id != 0)
+        UnloadRenderTexture(CachedFrame);
+    CachedFrame = RenderTexture2D{ 0 };
+    CachedFrameValid = false;
+}
+
+static void RenderCachedDrawData(ImDrawData* draw_data)
+{
+    uint64_t hash = HashDrawData(draw_data);
+    if (hash == 0)
+    {
+        CachedFrameValid = false;
+        ImGui_ImplRaylib_RenderDrawData(draw_data);
+        return;
+    }
+
+    ImGuiIO& io = ImGui::GetIO();
+    ImVec2 scale = GetFramebufferScale();
+    int width = int(io.DisplaySize.x * scale.x);
+    int height = int(io.DisplaySize.y * scale.y);
+    if (width <= 0 || height <= 0)
+        return;
+
+    if (CachedFrame.texture.width != width || CachedFrame.texture.height != height)
+    {
+        UnloadCachedFrame();
+        CachedFrame = LoadRenderTexture(width, height);
+    }
+
+    rlDrawRenderBatchActive();
+    if (!CachedFrameValid || hash != CachedFrameHash)
+    {
+        // EndTextureMode goes back to the screen with identity matrices
+        Matrix projection = rlGetMatrixProjection();
+        Matrix modelview = rlGetMatrixModelview();
+        BeginTextureMode(CachedFrame);
+        ClearBackground(BLANK);
+        rlScalef(scale.x, scale.y, 1);
+        // the texture keeps premultiplied color and the coverage as alpha
+        rlSetBlendFactorsSeparate(RL_SRC_ALPHA, RL_ONE_MINUS_SRC_ALPHA, RL_ONE, RL_ONE_MINUS_SRC_ALPHA, RL_FUNC_ADD, RL_FUNC_ADD);
+        rlSetBlendMode(RL_BLEND_CUSTOM_SEPARATE);
+        ImGui_ImplRaylib_RenderDrawData(draw_data);
+        rlSetBlendMode(RL_BLEND_ALPHA);
+        EndTextureMode();
+        rlSetMatrixProjection(projection);
+        rlSetMatrixModelview(modelview);
+
+        CachedFrameHash = hash;
+        CachedFrameValid = true;
+    }
+
+    BeginBlendMode(BLEND_ALPHA_PREMULTIPLY);
+    // render textures are upside down
+    DrawTexturePro(CachedFrame.texture, Rectangle{ 0, 0, float(width), -float(height) }, Rectangle{ 0, 0, io.DisplaySize.x, io.DisplaySize.y }, Vector2{ 0, 0 }, 0, WHITE);
+    EndBlendMode();
+}
+
+void rlImGuiSetCacheUnchangedFrames(bool enabled)
+{
+    CacheUnchangedFrames = enabled;
+    if (!enabled)
+        UnloadCachedFrame();
+}
+
 void rlImGuiEnd(void)
 {
     ImGui::SetCurrentContext(GlobalContext);
     ImGui::Render();
-    ImGui_ImplRaylib_RenderDrawData(ImGui::GetDrawData());
+    if (CacheUnchangedFrames)
+        RenderCachedDrawData(ImGui::GetDrawData());
+    else
+        ImGui_ImplRaylib_RenderDrawData(ImGui::GetDrawData());
 }
 
 void rlImGuiShutdown(void)
@@ -487,6 +875,7 @@ void rlImGuiShutdown(void)
 
     ImGui::SetCurrentContext(GlobalContext);
     ImGui_ImplRaylib_Shutdown();
+    UnloadCachedFrame();
 
     ImGui::DestroyContext(GlobalContext);
     GlobalContext = nullptr;
@@ -647,15 +1036,19 @@ void Imgui_ImplRaylib_BuildFontAtlas(void)
 void ImGui_ImplRaylib_Shutdown()
 {
     ImGuiIO& io =ImGui::GetIO();
-    Texture2D* fontTexture = (Texture2D*)io.Fonts->TexID;
 
-    if (fontTexture)
+    if (FontTexture)
     {
-        UnloadTexture(*fontTexture);
-        MemFree(fontTexture);
+        UnloadTexture(*FontTexture);
+        MemFree(FontTexture);
+        FontTexture = nullptr;
     }
 
     io.Fonts->TexID = 0;
+    RestoreGlyphRanges(io.Fonts);
+
+    UnloadDrawBuffers();
+    UnloadAlphaFontShader();
 }
 
 void ImGui_ImplRaylib_NewFrame(void)
@@ -666,28 +1059,80 @@ void ImGui_ImplRaylib_NewFrame(void)
 void ImGui_ImplRaylib_RenderDrawData(ImDrawData* draw_data)
 {
     rlDrawRenderBatchActive();
-    rlDisableBackfaceCulling();
 
+    if (draw_data->TotalIdxCount == 0)
+        return;
+
+    ReserveDrawBuffers(draw_data->TotalVtxCount * int(sizeof(ImDrawVert)), draw_data->TotalIdxCount * int(sizeof(ImDrawIdx)));
+
+    int vtxOffset = 0;
+    int idxOffset = 0;
     for (int l = 0; l < draw_data->CmdListsCount; ++l)
     {
         const ImDrawList* commandList = draw_data->CmdLists[l];
 
+        rlUpdateVertexBuffer(DrawVbo, commandList->VtxBuffer.Data, commandList->VtxBuffer.Size * int(sizeof(ImDrawVert)), vtxOffset * int(sizeof(ImDrawVert)));
+        rlUpdateVertexBufferElements(DrawIbo, commandList->IdxBuffer.Data, commandList->IdxBuffer.Size * int(sizeof(ImDrawIdx)), idxOffset * int(sizeof(ImDrawIdx)));
+
+        vtxOffset += commandList->VtxBuffer.Size;
+        idxOffset += commandList->IdxBuffer.Size;
+    }
+
+    vtxOffset = 0;
+    idxOffset = 0;
+    for (int l = 0; l < draw_data->CmdListsCount; ++l)
+    {
+        const ImDrawList* commandList = draw_data->CmdLists[l];
+
+        SetupRenderState(vtxOffset);
+        bool alphaFont = false;
+
         for (const auto& cmd : commandList->CmdBuffer)
         {
-            EnableScissor(cmd.ClipRect.x - draw_data->DisplayPos.x, cmd.ClipRect.y - draw_data->DisplayPos.y, cmd.ClipRect.z - (cmd.ClipRect.x - draw_data->DisplayPos.x), cmd.ClipRect.w - (cmd.ClipRect.y - draw_data->DisplayPos.y));
             if (cmd.UserCallback != nullptr)
             {
-                cmd.UserCallback(commandList, &cmd);
+                if (cmd.UserCallback != ImDrawCallback_ResetRenderState)
+                {
+                    cmd.UserCallback(commandList, &cmd);
+                    rlDrawRenderBatchActive();
+                }
 
+                SetupRenderState(vtxOffset);
+                alphaFont = false;
                 continue;
             }
 
-            ImGuiRenderTriangles(cmd.ElemCount, cmd.IdxOffset, commandList->IdxBuffer, commandList->VtxBuffer, cmd.TextureId);
-            rlDrawRenderBatchActive();
+            float x = cmd.ClipRect.x - draw_data->DisplayPos.x;
+            float y = cmd.ClipRect.y - draw_data->DisplayPos.y;
+            float width = cmd.ClipRect.z - (cmd.ClipRect.x - draw_data->DisplayPos.x);
+            float height = cmd.ClipRect.w - (cmd.ClipRect.y - draw_data->DisplayPos.y);
+            if (width <= 0 || height <= 0 || cmd.ElemCount == 0)
+                continue;
+            EnableScissor(x, y, width, height);
+
+            Texture* texture = (Texture*)cmd.TextureId;
+            if (IsAlpha8FontTexture(texture) != alphaFont)
+            {
+                alphaFont = !alphaFont;
+                if (alphaFont)
+                    SetupShader(AlphaFontShader, AlphaFontShaderLocs);
+                else
+                    SetupShader(rlGetShaderIdDefault(), rlGetShaderLocsDefault());
+            }
+            rlEnableTexture((texture == nullptr) ? rlGetTextureIdDefault() : texture->id);
+
+            rlDrawVertexArrayElements(idxOffset + int(cmd.IdxOffset), int(cmd.ElemCount), nullptr);
         }
+
+        vtxOffset += commandList->VtxBuffer.Size;
+        idxOffset += commandList->IdxBuffer.Size;
     }
 
-    rlSetTexture(0);
+    rlDisableVertexArray();
+    rlDisableVertexBuffer();
+    rlDisableVertexBufferElement();
+    rlDisableTexture();
+    rlDisableShader();
     rlDisableScissorTest();
     rlEnableBackfaceCulling();
 }
@@ -740,21 +1185,28 @@ bool ImGui_ImplRaylib_ProcessEvents(void)
         io.AddKeyEvent(ImGuiMod_Super, superDown);
     LastSuperPressed = superDown;
 
-    // get the pressed keys, just walk the keys so we don
-    for (int keyId = KEY_NULL; keyId < KeyboardKey::KEY_KP_EQUAL; keyId++)
+    // release the keys that went up since they were pressed
+    for (size_t i = 0; i < KeysDown.size();)
     {
-        if (!IsKeyPressed(keyId))
+        if (IsKeyDown(KeysDown[i]))
+        {
+            ++i;
             continue;
-        auto keyItr = RaylibKeyMap.find(KeyboardKey(keyId));
-        if (keyItr != RaylibKeyMap.end())
-            io.AddKeyEvent(keyItr->second, true);
+        }
+        io.AddKeyEvent(RaylibKeyMap[KeysDown[i]], false);
+        KeysDown[i] = KeysDown.back();
+        KeysDown.pop_back();
     }
 
-    // look for any keys that were down last frame and see if they were down and are released
-    for (const auto keyItr : RaylibKeyMap)
+    // get the keys pressed this frame, in order, from the raylib key queue.
+    // this empties the queue, so GetKeyPressed returns nothing after rlImGuiBegin
+    for (int keyId = GetKeyPressed(); keyId != KEY_NULL; keyId = GetKeyPressed())
     {
-        if (IsKeyReleased(keyItr.first))
-            io.AddKeyEvent(keyItr.second, false);
+        if (keyId < 0 || keyId >= int(IM_ARRAYSIZE(RaylibKeyMap)) || RaylibKeyMap[keyId] == ImGuiKey_None)
+            continue;
+        io.AddKeyEvent(RaylibKeyMap[keyId], true);
+        if (std::find(KeysDown.begin(), KeysDown.end(), KeyboardKey(keyId)) == KeysDown.end())
+            KeysDown.push_back(KeyboardKey(keyId));
     }
 
     if (io.WantCaptureKeyboard)
@@ -764,6 +1216,7 @@ bool ImGui_ImplRaylib_ProcessEvents(void)
         while (pressed != 0)
         {
             io.AddInputCharacter(pressed);
+            RequestGlyph(pressed);
             pressed = GetCharPressed();
         }
     }
@@ -55,6 +55,8 @@ void rlImGuiSetup(bool darkTheme);
 /// <summary>
 /// Starts a new ImGui Frame
 /// Calls ImGui_ImplRaylib_NewFrame, ImGui_ImplRaylib_ProcessEvents, and ImGui::NewFrame together
+/// Reads the new key presses with GetKeyPressed, which empties the raylib key queue. Call GetKeyPressed before
+/// rlImGuiBegin to see them too; IsKeyPressed and IsKeyDown are not affected.
 /// </summary>
 void rlImGuiBegin(void);
 
@@ -91,14 +93,43 @@ void rlImGuiEndInitImGui(void);
 /// </summary>
 void rlImGuiReloadFonts(void);
 
+/// <summary>
+/// Builds the font atlas with only the glyphs that were asked for with rlImGuiAddGlyphs or typed into ImGui,
+/// out of the ranges each font was added with. Latin-1 and icon fonts in the private use area are always built whole.
+/// Meant for fonts with large ranges, like CJK, where building every glyph is slow and makes a large texture.
+/// The atlas is built again at the start of the next frame when new glyphs are asked for.
+/// </summary>
+/// <param name="enabled">true to build only the requested glyphs</param>
+void rlImGuiSetDynamicGlyphs(bool enabled);
+
+/// <summary>
+/// Asks for the glyphs of a UTF-8 string, for rlImGuiSetDynamicGlyphs. Call it for the text a UI will show,
+/// like the strings of a localization table when it is loaded.
+/// </summary>
+/// <param name="text">the UTF-8 text</param>
+void rlImGuiAddGlyphs(const char* text);
+
 // Advanced Update API
 
 /// <summary>
 /// Starts a new ImGui Frame with a specified delta time
+/// Empties the raylib key queue like rlImGuiBegin, so call GetKeyPressed before it.
 /// </summary>
 /// <param name="dt">delta time, any value < 0 will use raylib GetFrameTime</param>
 void rlImGuiBeginDelta(float deltaTime);
 
+/// <summary>
+/// Keeps the rendered UI in a render texture and draws that texture again while the draw data does not change,
+/// instead of submitting the draw data every frame. Off by default.
+/// A frame that draws other textures than the font atlas, or has draw callbacks, is always submitted,
+/// since their content can change without the draw data changing.
+/// Rendering a changed frame switches to the texture and back with BeginTextureMode and EndTextureMode. The matrices
+/// are kept, but rlImGuiEnd then leaves the screen framebuffer and viewport bound, so with the cache on call it
+/// for the screen, not inside BeginTextureMode.
+/// </summary>
+/// <param name="enabled">true to reuse unchanged frames</param>
+void rlImGuiSetCacheUnchangedFrames(bool enabled);
+
 // ImGui Image API extensions
 // Purely for convenience in working with raylib textures as images.
 // If you want to call ImGui image functions directly, simply pass them the pointer to the texture.
@@ -2,13 +2,171 @@
 #include "tinygizmo_rotation.h"
 #include "tinygizmo_scaling.h"
 #include "tinygizmo_translation.h"
+#include <thread>
+#include <vector>
 
 namespace tinygizmo {
 
+// intersect_many culls the targets CULL_CHUNK at a time: the positions are
+// copied into SoA arrays and tested against the bounding sphere of the gizmo
+// in one vectorisable loop. Only the survivors pay for the local ray and the
+// mesh test.
+static constexpr size_t CULL_CHUNK = 64;
+// fewer targets than this per thread are not worth a thread
+static constexpr size_t TARGETS_PER_THREAD = 1024;
+
+template <typename COMPONENT>
+using TargetHit = std::optional<std::tuple<RayState, COMPONENT, size_t>>;
+
+static float bounding_radius(const AABB &bounds) {
+  return Float3{
+      std::max(std::abs(bounds.min.x), std::abs(bounds.max.x)),
+      std::max(std::abs(bounds.min.y), std::abs(bounds.max.y)),
+      std::max(std::abs(bounds.min.z), std::abs(bounds.max.z)),
+  }
+      .length();
+}
+
+template <typename COMPONENT, typename INTERSECT>
+static TargetHit<COMPONENT>
+intersect_range(const FrameState &frame, bool local_toggle, bool uniform,
+                std::span<const Transform> targets, size_t offset,
+                float radius, const INTERSECT &intersect) {
+  TargetHit<COMPONENT> best;
+  float best_t = std::numeric_limits<float>::infinity();
+
+  const auto o = frame.ray.origin;
+  const auto d = frame.ray.direction;
+  const float inv_d2 = 1.0f / d.length2();
+  // FrameState::calc_scale_screenspace without the distance
+  const bool screenspace = frame._screenspace_scale > 0.f;
+  const float screenspace_factor =
+      screenspace ? std::tan(frame.cam_yfov) *
+                        (frame._screenspace_scale / frame.viewport_size.y)
+                  : 0.f;
+
+  for (size_t begin = 0; begin < targets.size(); begin += CULL_CHUNK) {
+    const size_t count = std::min(CULL_CHUNK, targets.size() - begin);
+    float x[CULL_CHUNK];
+    float y[CULL_CHUNK];
+    float z[CULL_CHUNK];
+    for (size_t i = 0; i < count; ++i) {
+      auto &p = targets[begin + i].position;
+      x[i] = p.x - o.x;
+      y[i] = p.y - o.y;
+      z[i] = p.z - o.z;
+    }
+
+    bool candidate[CULL_CHUNK];
+    for (size_t i = 0; i < count; ++i) {
+      float l2 = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+      float along = x[i] * d.x + y[i] * d.y + z[i] * d.z;
+      float r = screenspace ? radius * std::sqrt(l2) * screenspace_factor
+                            : radius;
+      float r2 = r * r;
+      // squared distance from the gizmo center to the ray line
+      float dist2 = l2 - along * along * inv_d2;
+      candidate[i] = dist2 <= r2 && (along >= 0 || l2 <= r2);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+      if (!candidate[i]) {
+        continue;
+      }
+      auto &p = targets[begin + i];
+      auto [draw_scale, gizmo_transform, local_ray] =
+          frame.gizmo_transform_and_local_ray(local_toggle, p);
+      auto [active_component, t] = intersect(
+          local_ray, frame.pixels_per_unit(p.position), frame.pick_mode);
+      if (active_component && t < best_t) {
+        best_t = t;
+        best = std::make_tuple(
+            RayState{
+                .local_toggle = local_toggle,
+                .uniform = uniform,
+                .transform = p,
+                .draw_scale = draw_scale,
+                .gizmo_transform = gizmo_transform,
+                .local_ray = local_ray,
+                .t = t,
+            },
+            *active_component, offset + begin + i);
+      }
+    }
+  }
+  return best;
+}
+
+template <typename COMPONENT, typename INTERSECT>
+static TargetHit<COMPONENT>
+pick_target(const FrameState &frame, bool local_toggle, bool uniform,
+            std::span<const Transform> targets, const AABB &bounds,
+            unsigned threads, const INTERSECT &intersect) {
+  // a little margin for the rounding in the sphere test
+  const float radius = bounding_radius(bounds) * 1.01f;
+
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, targets.size() / TARGETS_PER_THREAD));
+  if (threads <= 1) {
+    return intersect_range<COMPONENT>(frame, local_toggle, uniform, targets, 0,
+                                      radius, intersect);
+  }
+
+  std::vector<TargetHit<COMPONENT>> results(threads);
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  const size_t per_thread = (targets.size() + threads - 1) / threads;
+  for (unsigned i = 0; i < threads; ++i) {
+    const size_t begin = i * per_thread;
+    const size_t count = std::min(per_thread, targets.size() - begin);
+    workers.emplace_back([&, i, begin, count] {
+      results[i] = intersect_range<COMPONENT>(
+          frame, local_toggle, uniform, targets.subspan(begin, count), begin,
+          radius, intersect);
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  // same tie break as a single pass: the lowest index wins
+  TargetHit<COMPONENT> best;
+  for (auto &result : results) {
+    if (result &&
+        (!best || std::get<0>(*result).t < std::get<0>(*best).t)) {
+      best = result;
+    }
+  }
+  return best;
+}
+
+// the drag cache is only filled for the winner
+template <typename COMPONENT, typename INTERSECT, typename DRAG_BEGIN>
+static TargetHit<COMPONENT>
+intersect_targets(const FrameState &frame, bool local_toggle, bool uniform,
+                  std::span<const Transform> targets, const AABB &bounds,
+                  unsigned threads, const INTERSECT &intersect,
+                  const DRAG_BEGIN &drag_begin) {
+  auto hit = pick_target<COMPONENT>(frame, local_toggle, uniform, targets,
+                                    bounds, threads, intersect);
+  if (hit) {
+    drag_begin(std::get<1>(*hit), frame, std::get<0>(*hit));
+  }
+  return hit;
+}
+
 void TranslationGizmo::mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_triangle,
-    std::optional<GizmoComponentType> active_component) {
-  position_mesh(modelMatrix, add_triangle, active_component);
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_triangle,
+    std::optional<GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  position_mesh(modelMatrix, add_triangle, active_component, pixels_per_unit);
+}
+
+void TranslationGizmo::mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  position_mesh(modelMatrix, add_mesh, active_component, pixels_per_unit);
 }
 
 std::optional<std::tuple<RayState, TranslationGizmo::GizmoComponentType>>
@@ -17,7 +175,8 @@ TranslationGizmo::intersect(const FrameState &frame, bool local_toggle,
   auto [draw_scale, gizmo_transform, local_ray] =
       frame.gizmo_transform_and_local_ray(local_toggle, p);
 
-  auto [active_component, t] = position_intersect(local_ray);
+  auto [active_component, t] = position_intersect(
+      local_ray, frame.pixels_per_unit(p.position), frame.pick_mode);
   if (!active_component) {
     return {};
   }
@@ -31,9 +190,20 @@ TranslationGizmo::intersect(const FrameState &frame, bool local_toggle,
       .local_ray = local_ray,
       .t = t,
   };
+  position_drag_begin(*active_component, frame, state);
   return std::make_pair(state, *active_component);
 }
 
+std::optional<
+    std::tuple<RayState, TranslationGizmo::GizmoComponentType, size_t>>
+TranslationGizmo::intersect_many(const FrameState &frame, bool local_toggle,
+                                std::span<const Transform> targets,
+                                unsigned threads) {
+  return intersect_targets<GizmoComponentType>(
+      frame, local_toggle, false, targets, position_bounds(), threads,
+      position_intersect, position_drag_begin);
+}
+
 Transform TranslationGizmo::drag(GizmoComponentType active_component,
                                  const FrameState &frame, const RayState &drag,
                                  const Transform &src) {
@@ -46,9 +216,17 @@ Transform TranslationGizmo::drag(GizmoComponentType active_component,
 }
 
 void RotationGizmo::mesh(const Float4x4 &modelMatrix,
-                         const AddTriangleFunc &add_triangle,
-                         std::optional<GizmoComponentType> active_component) {
-  rotation_mesh(modelMatrix, add_triangle, active_component);
+                         const AddTriangleRef &add_triangle,
+                         std::optional<GizmoComponentType> active_component,
+                         float pixels_per_unit) {
+  rotation_mesh(modelMatrix, add_triangle, active_component, pixels_per_unit);
+}
+
+void RotationGizmo::mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  rotation_mesh(modelMatrix, add_mesh, active_component, pixels_per_unit);
 }
 
 std::optional<std::tuple<RayState, RotationGizmo::GizmoComponentType>>
@@ -57,7 +235,8 @@ RotationGizmo::intersect(const FrameState &frame, bool local_toggle,
   auto [draw_scale, gizmo_transform, local_ray] =
       frame.gizmo_transform_and_local_ray(local_toggle, p);
 
-  auto [active_component, t] = rotation_intersect(local_ray);
+  auto [active_component, t] = rotation_intersect(
+      local_ray, frame.pixels_per_unit(p.position), frame.pick_mode);
   if (!active_component) {
     return {};
   }
@@ -71,9 +250,20 @@ RotationGizmo::intersect(const FrameState &frame, bool local_toggle,
       .local_ray = local_ray,
       .t = t,
   };
+  rotation_drag_begin(*active_component, frame, state);
   return std::make_pair(state, *active_component);
 }
 
+std::optional<
+    std::tuple<RayState, RotationGizmo::GizmoComponentType, size_t>>
+RotationGizmo::intersect_many(const FrameState &frame, bool local_toggle,
+                             std::span<const Transform> targets,
+                             unsigned threads) {
+  return intersect_targets<GizmoComponentType>(
+      frame, local_toggle, false, targets, rotation_bounds(), threads,
+      rotation_intersect, rotation_drag_begin);
+}
+
 Transform RotationGizmo::drag(GizmoComponentType active_component,
                               const FrameState &frame, const RayState &drag,
                               const Transform &src) {
@@ -87,9 +277,17 @@ Transform RotationGizmo::drag(GizmoComponentType active_component,
 }
 
 void ScalingGizmo::mesh(const Float4x4 &modelMatrix,
-                        const AddTriangleFunc &add_triangle,
-                        std::optional<GizmoComponentType> active_component) {
-  scaling_mesh(modelMatrix, add_triangle, active_component);
+                        const AddTriangleRef &add_triangle,
+                        std::optional<GizmoComponentType> active_component,
+                        float pixels_per_unit) {
+  scaling_mesh(modelMatrix, add_triangle, active_component, pixels_per_unit);
+}
+
+void ScalingGizmo::mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  scaling_mesh(modelMatrix, add_mesh, active_component, pixels_per_unit);
 }
 
 std::optional<std::tuple<RayState, ScalingGizmo::GizmoComponentType>>
@@ -98,7 +296,8 @@ ScalingGizmo::intersect(const FrameState &frame, bool local_toggle,
   auto [draw_scale, gizmo_transform, local_ray] =
       frame.gizmo_transform_and_local_ray(local_toggle, p);
 
-  auto [active_component, t] = scaling_intersect(local_ray);
+  auto [active_component, t] = scaling_intersect(
+      local_ray, frame.pixels_per_unit(p.position), frame.pick_mode);
   if (!active_component) {
     return {};
   }
@@ -112,9 +311,20 @@ ScalingGizmo::intersect(const FrameState &frame, bool local_toggle,
       .local_ray = local_ray,
       .t = t,
   };
+  scaling_drag_begin(*active_component, frame, state);
   return std::make_pair(state, *active_component);
 }
 
+std::optional<
+    std::tuple<RayState, ScalingGizmo::GizmoComponentType, size_t>>
+ScalingGizmo::intersect_many(const FrameState &frame, bool local_toggle,
+                            std::span<const Transform> targets, bool uniform,
+                            unsigned threads) {
+  return intersect_targets<GizmoComponentType>(
+      frame, local_toggle, uniform, targets, scaling_bounds(), threads,
+      scaling_intersect, scaling_drag_begin);
+}
+
 Transform ScalingGizmo::drag(GizmoComponentType active_component,
                              const FrameState &frame, const RayState &drag,
                              const Transform &src) {
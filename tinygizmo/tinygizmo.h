@@ -2,9 +2,28 @@
 // For more information, please refer to <http://unlicense.org>
 #pragma once
 #include "tinygizmo_alg.h"
+#include <unordered_map>
+#include <vector>
 
 namespace tinygizmo {
 
+// how intersect() tests the arrows, rings and maces
+enum class PickMode {
+  // the triangles of the drawn level of detail
+  Mesh,
+  // the solids the meshes approximate. constant time per component
+  Analytic,
+};
+
+// the nearest multiple of step. step <= 0 is no snapping
+inline float snap(float value, float step) {
+  return step > 0 ? std::round(value / step) * step : value;
+}
+
+inline Float3 snap(const Float3 &value, float step) {
+  return {snap(value.x, step), snap(value.y, step), snap(value.z, step)};
+}
+
 struct FrameState {
   bool mouse_down = false;
   // If > 0.f, the gizmos are drawn scale-invariant with a screenspace value
@@ -14,6 +33,12 @@ struct FrameState {
   Ray ray;
   float cam_yfov;
   Quaternion cam_orientation;
+  PickMode pick_mode = PickMode::Mesh;
+  // increments for *Gizmo::drag. 0 is off. the translation snaps to a world
+  // grid (a grid along the axis for an axis drag), rotation in radians
+  float snap_translation = 0;
+  float snap_rotation = 0;
+  float snap_scale = 0;
 
   // This will calculate a scale constant based on the number of screenspace
   // pixels passed as pixel_scale.
@@ -27,6 +52,17 @@ struct FrameState {
     return (_screenspace_scale > 0.f) ? calc_scale_screenspace(position) : 1.f;
   }
 
+  // Size in pixels of one local unit of a gizmo drawn at position, draw
+  // scale included. Picks the level of detail. 0 if the viewport is unknown.
+  float pixels_per_unit(const Float3 &position) const {
+    if (!(this->viewport_size.y > 0)) {
+      return 0;
+    }
+    float dist = (position - this->ray.origin).length();
+    return scale_screenspace(position) * this->viewport_size.y /
+           (std::tan(this->cam_yfov) * dist);
+  }
+
   std::tuple<float, Transform, Ray>
   gizmo_transform_and_local_ray(bool local_toggle, const Transform &src) const {
     auto draw_scale = this->scale_screenspace(src.position);
@@ -40,6 +76,21 @@ struct FrameState {
   };
 };
 
+// What drag() needs that stays the same while the mouse moves. intersect()
+// fills it for the picked component, so that each drag frame is one ray vs
+// plane test.
+struct DragCache {
+  Plane plane;
+  // translation and scaling: the constraint axis. rotation: the ring axis
+  Float3 axis;
+  // translation: from the position to the click point. rotation and
+  // scaling: the click point
+  Float3 click;
+  // rotation: the center of the ring and the unit arm to the click point
+  Float3 center;
+  Float3 arm;
+};
+
 struct RayState {
   bool local_toggle;
   bool uniform;
@@ -48,6 +99,7 @@ struct RayState {
   Transform gizmo_transform;
   Ray local_ray;
   float t;
+  DragCache cache;
 };
 
 namespace TranslationGizmo {
@@ -61,12 +113,27 @@ enum class GizmoComponentType {
   TranslationView,
 };
 
-void mesh(const Float4x4 &modelMatrix, const AddTriangleFunc &add_triangle,
-          std::optional<GizmoComponentType> active_component);
+// pixels_per_unit: FrameState::pixels_per_unit of the gizmo position picks
+// the level of detail that intersect() uses too. 0 for the default level.
+void mesh(const Float4x4 &modelMatrix, const AddTriangleRef &add_triangle,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
+
+// emits each component once as local space geometry + modelMatrix
+void mesh(const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
 
 std::optional<std::tuple<RayState, GizmoComponentType>>
 intersect(const FrameState &frame, bool local_toggle, const Transform &p);
 
+// Nearest hit over many targets. The size_t is the index into targets.
+// threads > 1 splits large spans over that many threads, started and joined
+// in the call. that pays off for a batch of rays, not for one ray a frame.
+std::optional<std::tuple<RayState, GizmoComponentType, size_t>>
+intersect_many(const FrameState &frame, bool local_toggle,
+               std::span<const Transform> targets, unsigned threads = 1);
+
 Transform drag(GizmoComponentType active_component, const FrameState &frame,
                const RayState &drag, const Transform &src);
 }; // namespace TranslationGizmo
@@ -78,12 +145,27 @@ enum class GizmoComponentType {
   RotationZ,
 };
 
-void mesh(const Float4x4 &modelMatrix, const AddTriangleFunc &add_triangle,
-          std::optional<GizmoComponentType> active_component);
+// pixels_per_unit: FrameState::pixels_per_unit of the gizmo position picks
+// the level of detail that intersect() uses too. 0 for the default level.
+void mesh(const Float4x4 &modelMatrix, const AddTriangleRef &add_triangle,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
+
+// emits each component once as local space geometry + modelMatrix
+void mesh(const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
 
 std::optional<std::tuple<RayState, GizmoComponentType>>
 intersect(const FrameState &frame, bool local_toggle, const Transform &p);
 
+// Nearest hit over many targets. The size_t is the index into targets.
+// threads > 1 splits large spans over that many threads, started and joined
+// in the call. that pays off for a batch of rays, not for one ray a frame.
+std::optional<std::tuple<RayState, GizmoComponentType, size_t>>
+intersect_many(const FrameState &frame, bool local_toggle,
+               std::span<const Transform> targets, unsigned threads = 1);
+
 Transform drag(GizmoComponentType active_component, const FrameState &frame,
                const RayState &drag, const Transform &src);
 } // namespace RotationGizmo
@@ -95,15 +177,94 @@ enum class GizmoComponentType {
   ScalingZ,
 };
 
-void mesh(const Float4x4 &modelMatrix, const AddTriangleFunc &add_triangle,
-          std::optional<GizmoComponentType> active_component);
+// pixels_per_unit: FrameState::pixels_per_unit of the gizmo position picks
+// the level of detail that intersect() uses too. 0 for the default level.
+void mesh(const Float4x4 &modelMatrix, const AddTriangleRef &add_triangle,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
+
+// emits each component once as local space geometry + modelMatrix
+void mesh(const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+          std::optional<GizmoComponentType> active_component,
+          float pixels_per_unit = 0);
 
 std::optional<std::tuple<RayState, GizmoComponentType>>
 intersect(const FrameState &frame, bool local_toggle, const Transform &p,
           bool uniform);
 
+// Nearest hit over many targets. The size_t is the index into targets.
+// threads > 1 splits large spans over that many threads, started and joined
+// in the call. that pays off for a batch of rays, not for one ray a frame.
+std::optional<std::tuple<RayState, GizmoComponentType, size_t>>
+intersect_many(const FrameState &frame, bool local_toggle,
+               std::span<const Transform> targets, bool uniform,
+               unsigned threads = 1);
+
 Transform drag(GizmoComponentType active_component, const FrameState &frame,
                const RayState &drag, const Transform &src);
 }; // namespace ScalingGizmo
 
+// Drags a whole selection with one gizmo. The gizmo drag runs once, on the
+// active object, and apply() moves every member by the same delta around a
+// shared pivot. Members are kept as SoA arrays of their transforms at begin().
+struct GroupDrag {
+  enum class Pivot {
+    Centroid,
+    Active,
+  };
+
+  // the transforms at begin()
+  std::vector<float> px, py, pz;
+  std::vector<float> qx, qy, qz, qw;
+  std::vector<float> sx, sy, sz;
+  Transform active;
+  Float3 pivot;
+
+  size_t size() const { return this->px.size(); }
+
+  // active: the transform the gizmo drags. usually one of the selection
+  void begin(std::span<const Transform> selection, const Transform &active,
+             Pivot pivot = Pivot::Centroid);
+
+  // active_dst: what *Gizmo::drag returned for the active transform.
+  // Writes the selection into dst (size() transforms). Rotation and
+  // translation are exact. Scale is multiplied per axis in each member's own
+  // space and the offsets are scaled along the active transform's axes.
+  // threads > 1 splits large selections over that many threads, started and
+  // joined in the call. for a batch, a drag a frame is faster with 1.
+  void apply(const Transform &active_dst, std::span<Transform> dst,
+             unsigned threads = 1) const;
+};
+
+// Finds the scene vertex or surface point nearest to a point, for vertex and
+// surface snapping. The vertices and the triangles are bucketed into a
+// hashed grid, and a query visits the cells ring by ring around the point
+// until the rest can not be nearer. build() once per mesh, in its local
+// space, and query with detransform_point().
+struct SnapIndex {
+  float cell = 0;
+  AABB bounds;
+  // sorted by cell
+  std::vector<Float3> vertices;
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> vertex_cells;
+  // the triangles, and a reference per cell their bounds overlap
+  std::vector<Float3> positions;
+  std::vector<uint32_t> indices;
+  std::vector<uint32_t> triangle_refs;
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> triangle_cells;
+
+  bool empty() const { return this->vertices.empty(); }
+
+  // indices: a triangle list, may be empty for vertex snapping only.
+  // cell <= 0 picks a size from the bounds and the vertex count
+  void build(std::span<const Float3> positions,
+             std::span<const uint32_t> indices = {}, float cell = 0);
+
+  // the nearest vertex within radius
+  std::optional<Float3> nearest_vertex(const Float3 &p, float radius) const;
+
+  // the nearest point on a triangle within radius
+  std::optional<Float3> nearest_surface(const Float3 &p, float radius) const;
+};
+
 } // namespace tinygizmo
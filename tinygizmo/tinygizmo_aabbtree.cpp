@@ -0,0 +1,200 @@
+#include "tinygizmo_aabbtree.h"
+#include <assert.h>
+
+namespace tinygizmo {
+
+// the cost of a node for the surface area heuristic
+static float area(const AABB &aabb) {
+  auto d = aabb.max - aabb.min;
+  return 2 * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+uint32_t AabbTree::allocate() {
+  if (this->free_list == NONE) {
+    this->nodes.push_back({});
+    return static_cast<uint32_t>(this->nodes.size() - 1);
+  }
+  auto node = this->free_list;
+  this->free_list = this->nodes[node].parent;
+  this->nodes[node] = {};
+  return node;
+}
+
+void AabbTree::release(uint32_t node) {
+  this->nodes[node] = {.parent = this->free_list};
+  this->free_list = node;
+}
+
+uint32_t AabbTree::insert(const AABB &aabb, uint32_t item) {
+  auto leaf = this->allocate();
+  auto &node = this->nodes[leaf];
+  const Float3 r = {this->margin, this->margin, this->margin};
+  node.aabb = {aabb.min - r, aabb.max + r};
+  node.item = item;
+  node.height = 0;
+  this->insert_leaf(leaf);
+  return leaf;
+}
+
+void AabbTree::remove(uint32_t proxy) {
+  assert(this->nodes[proxy].is_leaf());
+  this->remove_leaf(proxy);
+  this->release(proxy);
+}
+
+bool AabbTree::move(uint32_t proxy, const AABB &aabb) {
+  auto &fat = this->nodes[proxy].aabb;
+  if (fat.min.x <= aabb.min.x && fat.min.y <= aabb.min.y &&
+      fat.min.z <= aabb.min.z && aabb.max.x <= fat.max.x &&
+      aabb.max.y <= fat.max.y && aabb.max.z <= fat.max.z) {
+    return false;
+  }
+  this->remove_leaf(proxy);
+  const Float3 r = {this->margin, this->margin, this->margin};
+  this->nodes[proxy].aabb = {aabb.min - r, aabb.max + r};
+  this->insert_leaf(proxy);
+  return true;
+}
+
+void AabbTree::refit(uint32_t index) {
+  auto &node = this->nodes[index];
+  auto &left = this->nodes[node.left];
+  auto &right = this->nodes[node.right];
+  node.height = 1 + std::max(left.height, right.height);
+  node.aabb = merge(left.aabb, right.aabb);
+}
+
+void AabbTree::insert_leaf(uint32_t leaf) {
+  if (this->root == NONE) {
+    this->root = leaf;
+    this->nodes[leaf].parent = NONE;
+    return;
+  }
+
+  // the sibling that makes the tree cheapest
+  const auto leaf_aabb = this->nodes[leaf].aabb;
+  auto index = this->root;
+  while (!this->nodes[index].is_leaf()) {
+    auto &node = this->nodes[index];
+    float combined = area(merge(node.aabb, leaf_aabb));
+    // a new parent for this node and the leaf
+    float cost = 2 * combined;
+    // pushing the leaf further down grows this node
+    float inheritance = 2 * (combined - area(node.aabb));
+    auto descend = [&](uint32_t child) {
+      auto &c = this->nodes[child];
+      float merged = area(merge(leaf_aabb, c.aabb));
+      return c.is_leaf() ? merged + inheritance
+                         : merged - area(c.aabb) + inheritance;
+    };
+    float cost_left = descend(node.left);
+    float cost_right = descend(node.right);
+    if (cost < cost_left && cost < cost_right) {
+      break;
+    }
+    index = cost_left < cost_right ? node.left : node.right;
+  }
+
+  const auto sibling = index;
+  const auto old_parent = this->nodes[sibling].parent;
+  const auto new_parent = this->allocate();
+  {
+    auto &p = this->nodes[new_parent];
+    p.parent = old_parent;
+    p.aabb = merge(leaf_aabb, this->nodes[sibling].aabb);
+    p.height = this->nodes[sibling].height + 1;
+    p.left = sibling;
+    p.right = leaf;
+  }
+  if (old_parent != NONE) {
+    auto &op = this->nodes[old_parent];
+    (op.left == sibling ? op.left : op.right) = new_parent;
+  } else {
+    this->root = new_parent;
+  }
+  this->nodes[sibling].parent = new_parent;
+  this->nodes[leaf].parent = new_parent;
+
+  for (index = this->nodes[leaf].parent; index != NONE;
+       index = this->nodes[index].parent) {
+    index = this->balance(index);
+    this->refit(index);
+  }
+}
+
+void AabbTree::remove_leaf(uint32_t leaf) {
+  if (leaf == this->root) {
+    this->root = NONE;
+    return;
+  }
+  const auto parent = this->nodes[leaf].parent;
+  const auto grand_parent = this->nodes[parent].parent;
+  const auto sibling = this->nodes[parent].left == leaf
+                           ? this->nodes[parent].right
+                           : this->nodes[parent].left;
+  this->release(parent);
+  if (grand_parent == NONE) {
+    this->root = sibling;
+    this->nodes[sibling].parent = NONE;
+    return;
+  }
+  auto &gp = this->nodes[grand_parent];
+  (gp.left == parent ? gp.left : gp.right) = sibling;
+  this->nodes[sibling].parent = grand_parent;
+  for (auto index = grand_parent; index != NONE;
+       index = this->nodes[index].parent) {
+    index = this->balance(index);
+    this->refit(index);
+  }
+}
+
+// Rotates a child up if a's children differ in height by more than one.
+// Returns the root of the subtree.
+uint32_t AabbTree::balance(uint32_t ia) {
+  auto &a = this->nodes[ia];
+  if (a.is_leaf() || a.height < 2) {
+    return ia;
+  }
+  const auto ib = a.left;
+  const auto ic = a.right;
+  const int32_t skew = this->nodes[ic].height - this->nodes[ib].height;
+  if (skew >= -1 && skew <= 1) {
+    return ia;
+  }
+
+  // up: the higher child. its higher child stays below it, the other one
+  // goes down to a
+  const auto iup = skew > 0 ? ic : ib;
+  const auto idown = skew > 0 ? ib : ic;
+  auto &up = this->nodes[iup];
+  const auto i1 = up.left;
+  const auto i2 = up.right;
+
+  up.left = ia;
+  up.parent = a.parent;
+  a.parent = iup;
+  if (up.parent != NONE) {
+    auto &p = this->nodes[up.parent];
+    (p.left == ia ? p.left : p.right) = iup;
+  } else {
+    this->root = iup;
+  }
+
+  const bool keep_first = this->nodes[i1].height > this->nodes[i2].height;
+  const auto keep = keep_first ? i1 : i2;
+  const auto give = keep_first ? i2 : i1;
+  up.right = keep;
+  if (skew > 0) {
+    a.left = idown;
+    a.right = give;
+  } else {
+    a.left = give;
+    a.right = idown;
+  }
+  this->nodes[give].parent = ia;
+  this->refit(ia);
+  this->refit(iup);
+  return iup;
+}
+
+} // namespace tinygizmo
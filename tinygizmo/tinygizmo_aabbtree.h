@@ -0,0 +1,238 @@
+#pragma once
+#include "tinygizmo_alg.h"
+#include <vector>
+
+namespace tinygizmo {
+
+// A dynamic AABB tree, the broadphase of Box2D in 3D. A leaf holds a box a
+// little larger than its item, so that small moves leave the tree alone, and
+// insertions keep it balanced with rotations. Leaves are addressed by proxy,
+// the index of their node, which stays valid until remove().
+struct AabbTree {
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+  struct Node {
+    AABB aabb;
+    // the next free node while on the free list
+    uint32_t parent = NONE;
+    uint32_t left = NONE;
+    uint32_t right = NONE;
+    // leaf only
+    uint32_t item = NONE;
+    // leaf 0, free -1
+    int32_t height = -1;
+
+    bool is_leaf() const { return this->left == NONE; }
+  };
+
+  std::vector<Node> nodes;
+  uint32_t root = NONE;
+  uint32_t free_list = NONE;
+  // how much a leaf box grows on each side
+  float margin = 0.1f;
+
+  uint32_t insert(const AABB &aabb, uint32_t item);
+  void remove(uint32_t proxy);
+  // refit the leaf if aabb is no longer inside its box. true if it was
+  bool move(uint32_t proxy, const AABB &aabb);
+
+  const AABB &fat_aabb(uint32_t proxy) const { return nodes[proxy].aabb; }
+  uint32_t item(uint32_t proxy) const { return nodes[proxy].item; }
+  int32_t height() const { return root == NONE ? 0 : nodes[root].height; }
+
+  // visit(item, max_t) for each leaf box the ray enters before max_t, the
+  // nearer child first. visit returns the new max_t, the t of its exact hit
+  // if it is nearer, so that the boxes behind it are skipped.
+  template <typename F>
+  void raycast(const Ray &ray, float max_t, const F &visit) const {
+    Stack stack;
+    if (this->root != NONE) {
+      stack.push(this->root);
+    }
+    while (!stack.empty()) {
+      auto &node = this->nodes[stack.pop()];
+      float t;
+      if (!ray.intersect_aabb(node.aabb, &t) || t > max_t) {
+        continue;
+      }
+      if (node.is_leaf()) {
+        max_t = visit(node.item, max_t);
+        continue;
+      }
+      float tl = std::numeric_limits<float>::infinity();
+      float tr = std::numeric_limits<float>::infinity();
+      bool l = ray.intersect_aabb(this->nodes[node.left].aabb, &tl);
+      bool r = ray.intersect_aabb(this->nodes[node.right].aabb, &tr);
+      // the nearer one is popped first
+      if (l && r && tl <= tr) {
+        stack.push(node.right);
+        stack.push(node.left);
+      } else if (l && r) {
+        stack.push(node.left);
+        stack.push(node.right);
+      } else if (l) {
+        stack.push(node.left);
+      } else if (r) {
+        stack.push(node.right);
+      }
+    }
+  }
+
+  // visit(item) for each leaf box that overlaps aabb
+  template <typename F> void overlap(const AABB &aabb, const F &visit) const {
+    Stack stack;
+    if (this->root != NONE) {
+      stack.push(this->root);
+    }
+    while (!stack.empty()) {
+      auto &node = this->nodes[stack.pop()];
+      if (!overlaps(node.aabb, aabb)) {
+        continue;
+      }
+      if (node.is_leaf()) {
+        visit(node.item);
+      } else {
+        stack.push(node.left);
+        stack.push(node.right);
+      }
+    }
+  }
+
+  // visit(item) for each leaf box not entirely behind one of the planes. the
+  // planes face inward
+  template <typename F>
+  void frustum(std::span<const Plane> planes, const F &visit) const {
+    // a node entirely in front of every plane is marked, and its subtree is
+    // visited without tests
+    constexpr uint32_t INSIDE = 0x80000000;
+    Stack stack;
+    if (this->root != NONE) {
+      stack.push(this->root);
+    }
+    while (!stack.empty()) {
+      auto entry = stack.pop();
+      auto &node = this->nodes[entry & ~INSIDE];
+      bool inside = (entry & INSIDE) != 0;
+      if (!inside) {
+        inside = true;
+        bool outside = false;
+        for (auto &plane : planes) {
+          // the corners farthest along and against the normal
+          auto &lo = node.aabb.min;
+          auto &hi = node.aabb.max;
+          auto &n = plane.normal;
+          Float3 far = {n.x >= 0 ? hi.x : lo.x, n.y >= 0 ? hi.y : lo.y,
+                        n.z >= 0 ? hi.z : lo.z};
+          Float3 near = {n.x >= 0 ? lo.x : hi.x, n.y >= 0 ? lo.y : hi.y,
+                         n.z >= 0 ? lo.z : hi.z};
+          if (Float3::dot(n, far) + plane.d < 0) {
+            outside = true;
+            break;
+          }
+          if (Float3::dot(n, near) + plane.d < 0) {
+            inside = false;
+          }
+        }
+        if (outside) {
+          continue;
+        }
+      }
+      if (node.is_leaf()) {
+        visit(node.item);
+      } else {
+        auto mark = inside ? INSIDE : 0;
+        stack.push(node.left | mark);
+        stack.push(node.right | mark);
+      }
+    }
+  }
+
+  // visit(item, best) for the leaf boxes nearer to p than best, the nearer
+  // child first. best starts at max_distance, visit returns the new best.
+  template <typename F>
+  void nearest(const Float3 &p, float max_distance, const F &visit) const {
+    Stack stack;
+    if (this->root != NONE) {
+      stack.push(this->root);
+    }
+    float best = max_distance;
+    while (!stack.empty()) {
+      auto &node = this->nodes[stack.pop()];
+      if (distance(node.aabb, p) > best) {
+        continue;
+      }
+      if (node.is_leaf()) {
+        best = visit(node.item, best);
+        continue;
+      }
+      if (distance(this->nodes[node.left].aabb, p) <=
+          distance(this->nodes[node.right].aabb, p)) {
+        stack.push(node.right);
+        stack.push(node.left);
+      } else {
+        stack.push(node.left);
+        stack.push(node.right);
+      }
+    }
+  }
+
+  static AABB merge(const AABB &a, const AABB &b) {
+    return {
+        {std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y),
+         std::min(a.min.z, b.min.z)},
+        {std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y),
+         std::max(a.max.z, b.max.z)},
+    };
+  }
+
+  static bool overlaps(const AABB &a, const AABB &b) {
+    return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y &&
+           b.min.y <= a.max.y && a.min.z <= b.max.z && b.min.z <= a.max.z;
+  }
+
+  // 0 inside
+  static float distance(const AABB &aabb, const Float3 &p) {
+    Float3 d = {
+        std::max({aabb.min.x - p.x, 0.0f, p.x - aabb.max.x}),
+        std::max({aabb.min.y - p.y, 0.0f, p.y - aabb.max.y}),
+        std::max({aabb.min.z - p.z, 0.0f, p.z - aabb.max.z}),
+    };
+    return d.length();
+  }
+
+private:
+  // the traversal stack. on the C stack unless the tree is very deep
+  struct Stack {
+    uint32_t fixed[256];
+    std::vector<uint32_t> heap;
+    size_t count = 0;
+
+    bool empty() const { return this->count == 0; }
+    void push(uint32_t node) {
+      if (this->count < std::size(this->fixed)) {
+        this->fixed[this->count] = node;
+      } else {
+        this->heap.push_back(node);
+      }
+      ++this->count;
+    }
+    uint32_t pop() {
+      --this->count;
+      if (this->count < std::size(this->fixed)) {
+        return this->fixed[this->count];
+      }
+      auto node = this->heap.back();
+      this->heap.pop_back();
+      return node;
+    }
+  };
+
+  uint32_t allocate();
+  void release(uint32_t node);
+  void insert_leaf(uint32_t leaf);
+  void remove_leaf(uint32_t leaf);
+  uint32_t balance(uint32_t a);
+  void refit(uint32_t node);
+};
+
+} // namespace tinygizmo
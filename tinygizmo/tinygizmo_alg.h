@@ -1,8 +1,27 @@
 #pragma once
+#include <algorithm>
 #include <cmath>
-#include <functional>
+#include <limits>
+#include <memory>
 #include <optional>
+#include <span>
 #include <stdint.h>
+#include <type_traits>
+
+// Opt-in SIMD backend for the 4x4 math (define TINYGIZMO_SIMD for every
+// translation unit). SSE on x86 (SSE4.1/AVX2 builds included) and NEON on
+// ARM. The public types and their layout do not change, and the lanes are
+// summed in the same order as the scalar code.
+#if defined(TINYGIZMO_SIMD)
+#if defined(__SSE4_1__) || defined(__AVX2__) || defined(__SSE2__) ||           \
+    defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <xmmintrin.h>
+#define TINYGIZMO_SIMD_SSE
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define TINYGIZMO_SIMD_NEON
+#endif
+#endif
 
 namespace tinygizmo {
 
@@ -10,7 +29,9 @@ struct Float2 {
   float x;
   float y;
 
-  Float2 operator+(const Float2 &rhs) const { return {x + rhs.x, y + rhs.y}; }
+  constexpr Float2 operator+(const Float2 &rhs) const {
+    return {x + rhs.x, y + rhs.y};
+  }
 };
 
 struct Float3 {
@@ -18,15 +39,15 @@ struct Float3 {
   float y;
   float z;
 
-  static float dot(const Float3 &lhs, const Float3 &rhs) {
+  static constexpr float dot(const Float3 &lhs, const Float3 &rhs) {
     return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
   }
 
-  float length2() const { return dot(*this, *this); }
+  constexpr float length2() const { return dot(*this, *this); }
 
   float length() const { return std::sqrt(length2()); }
 
-  Float3 scale(float f) const {
+  constexpr Float3 scale(float f) const {
     return {
         x * f,
         y * f,
@@ -36,12 +57,12 @@ struct Float3 {
 
   Float3 normalize() const { return scale(1.0f / length()); };
 
-  static Float3 cross(const Float3 &a, const Float3 &b) {
+  static constexpr Float3 cross(const Float3 &a, const Float3 &b) {
     return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z,
             a.x * b.y - a.y * b.x};
   }
 
-  Float3 operator+(const Float3 &rhs) const {
+  constexpr Float3 operator+(const Float3 &rhs) const {
     return {
         x + rhs.x,
         y + rhs.y,
@@ -49,7 +70,7 @@ struct Float3 {
     };
   }
 
-  Float3 operator-() const {
+  constexpr Float3 operator-() const {
     return {
         -x,
         -y,
@@ -57,7 +78,7 @@ struct Float3 {
     };
   }
 
-  Float3 operator-(const Float3 &rhs) const {
+  constexpr Float3 operator-(const Float3 &rhs) const {
     return {
         x - rhs.x,
         y - rhs.y,
@@ -65,7 +86,7 @@ struct Float3 {
     };
   }
 
-  Float3 mult_each(const Float3 &rhs) const {
+  constexpr Float3 mult_each(const Float3 &rhs) const {
     return {
         x * rhs.x,
         y * rhs.y,
@@ -73,7 +94,7 @@ struct Float3 {
     };
   }
 
-  Float3 div_each(const Float3 &rhs) const {
+  constexpr Float3 div_each(const Float3 &rhs) const {
     return {
         x / rhs.x,
         y / rhs.y,
@@ -94,17 +115,17 @@ struct Float4 {
   float z;
   float w;
 
-  static float dot(const Float4 &lhs, const Float4 &rhs) {
+  static constexpr float dot(const Float4 &lhs, const Float4 &rhs) {
     return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z + lhs.w * rhs.w;
   }
 
-  float length2() const { return dot(*this, *this); }
+  constexpr float length2() const { return dot(*this, *this); }
 
   float length() const { return std::sqrt(length2()); }
 
-  Float3 xyz() const { return {x, y, z}; }
+  constexpr Float3 xyz() const { return {x, y, z}; }
 
-  Float4 static make(const Float3 &v, float w) {
+  static constexpr Float4 make(const Float3 &v, float w) {
     return {
         v.x,
         v.y,
@@ -150,6 +171,40 @@ struct Float4x4 {
   };
 
   Float4x4 operator*(const Float4x4 &rhs) const {
+#if defined(TINYGIZMO_SIMD_SSE)
+    // row i = sum_k m[i][k] * rhs.row(k)
+    const __m128 r0 = _mm_loadu_ps(&rhs.m00);
+    const __m128 r1 = _mm_loadu_ps(&rhs.m10);
+    const __m128 r2 = _mm_loadu_ps(&rhs.m20);
+    const __m128 r3 = _mm_loadu_ps(&rhs.m30);
+    Float4x4 result;
+    const float *lhs = &m00;
+    float *dst = &result.m00;
+    for (int i = 0; i < 4; ++i, lhs += 4, dst += 4) {
+      __m128 row = _mm_mul_ps(_mm_set1_ps(lhs[0]), r0);
+      row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[1]), r1));
+      row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[2]), r2));
+      row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(lhs[3]), r3));
+      _mm_storeu_ps(dst, row);
+    }
+    return result;
+#elif defined(TINYGIZMO_SIMD_NEON)
+    const float32x4_t r0 = vld1q_f32(&rhs.m00);
+    const float32x4_t r1 = vld1q_f32(&rhs.m10);
+    const float32x4_t r2 = vld1q_f32(&rhs.m20);
+    const float32x4_t r3 = vld1q_f32(&rhs.m30);
+    Float4x4 result;
+    const float *lhs = &m00;
+    float *dst = &result.m00;
+    for (int i = 0; i < 4; ++i, lhs += 4, dst += 4) {
+      float32x4_t row = vmulq_n_f32(r0, lhs[0]);
+      row = vaddq_f32(row, vmulq_n_f32(r1, lhs[1]));
+      row = vaddq_f32(row, vmulq_n_f32(r2, lhs[2]));
+      row = vaddq_f32(row, vmulq_n_f32(r3, lhs[3]));
+      vst1q_f32(dst, row);
+    }
+    return result;
+#else
     return {
         Float4::dot(row0(), rhs.col0()), Float4::dot(row0(), rhs.col1()),
         Float4::dot(row0(), rhs.col2()), Float4::dot(row0(), rhs.col3()), //
@@ -160,15 +215,44 @@ struct Float4x4 {
         Float4::dot(row3(), rhs.col0()), Float4::dot(row3(), rhs.col1()),
         Float4::dot(row3(), rhs.col2()), Float4::dot(row3(), rhs.col3()), //
     };
+#endif
+  }
+
+  // affine. no perspective divide
+  Float3 transform_point(const Float3 &p) const {
+    return {
+        p.x * m00 + p.y * m10 + p.z * m20 + m30,
+        p.x * m01 + p.y * m11 + p.z * m21 + m31,
+        p.x * m02 + p.y * m12 + p.z * m22 + m32,
+    };
   }
 
   Float4 transform(const Float4 &rhs) const {
+#if defined(TINYGIZMO_SIMD_SSE)
+    // sum_k rhs[k] * row(k)
+    __m128 r = _mm_mul_ps(_mm_set1_ps(rhs.x), _mm_loadu_ps(&m00));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(rhs.y), _mm_loadu_ps(&m10)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(rhs.z), _mm_loadu_ps(&m20)));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(rhs.w), _mm_loadu_ps(&m30)));
+    Float4 result;
+    _mm_storeu_ps(&result.x, r);
+    return result;
+#elif defined(TINYGIZMO_SIMD_NEON)
+    float32x4_t r = vmulq_n_f32(vld1q_f32(&m00), rhs.x);
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(&m10), rhs.y));
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(&m20), rhs.z));
+    r = vaddq_f32(r, vmulq_n_f32(vld1q_f32(&m30), rhs.w));
+    Float4 result;
+    vst1q_f32(&result.x, r);
+    return result;
+#else
     return {
         Float4::dot(rhs, col0()),
         Float4::dot(rhs, col1()),
         Float4::dot(rhs, col2()),
         Float4::dot(rhs, col3()),
     };
+#endif
   }
 };
 
@@ -215,11 +299,25 @@ struct Quaternion : Float4 {
   Quaternion conjugage() const { return {-x, -y, -z, w}; }
   Quaternion inverse() const { return conjugage().scale(1.0f / length2()); }
 
+  // xdir().scale(v.x) + ydir().scale(v.y) + zdir().scale(v.z), with the
+  // products shared by the three axes computed once
   Float3 rotate(const Float3 &v) const {
-    return xdir().scale(v.x) + ydir().scale(v.y) + zdir().scale(v.z);
+    const float ww = w * w, xx = x * x, yy = y * y, zz = z * z;
+    const float xy = x * y, yz = y * z, zx = z * x;
+    const float xw = x * w, yw = y * w, zw = z * w;
+    const Float3 xd = {ww + xx - yy - zz, (xy + zw) * 2, (zx - yw) * 2};
+    const Float3 yd = {(xy - zw) * 2, ww - xx + yy - zz, (yz + xw) * 2};
+    const Float3 zd = {(zx + yw) * 2, (yz - xw) * 2, ww - xx - yy + zz};
+    return xd.scale(v.x) + yd.scale(v.y) + zd.scale(v.z);
   }
 };
 
+// the SIMD backend loads these as packed floats
+static_assert(sizeof(Float4) == sizeof(float) * 4);
+static_assert(sizeof(Quaternion) == sizeof(float) * 4);
+static_assert(sizeof(Float4x4) == sizeof(float) * 16);
+static_assert(std::is_standard_layout_v<Float4x4>);
+
 struct Transform {
   Quaternion orientation = {0, 0, 0, 1};
   Float3 position = {0, 0, 0};
@@ -262,14 +360,99 @@ struct Plane {
   }
 };
 
+// floor(v / cell), the cell of a hashed grid. clamped, so that the cells
+// around it still fit in int32_t, and 0 for nan
+inline int32_t grid_cell(float v, float cell) {
+  constexpr float LIMIT = 1 << 30;
+  auto c = std::floor(v / cell);
+  if (c != c) {
+    return 0;
+  }
+  return static_cast<int32_t>(std::clamp(c, -LIMIT, LIMIT));
+}
+
+struct AABB {
+  Float3 min = {std::numeric_limits<float>::infinity(),
+                std::numeric_limits<float>::infinity(),
+                std::numeric_limits<float>::infinity()};
+  Float3 max = {-std::numeric_limits<float>::infinity(),
+                -std::numeric_limits<float>::infinity(),
+                -std::numeric_limits<float>::infinity()};
+
+  constexpr bool empty() const {
+    return min.x > max.x || min.y > max.y || min.z > max.z;
+  }
+
+  constexpr void extend(const Float3 &p) {
+    min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+    max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+  }
+
+  constexpr void extend(const AABB &rhs) {
+    if (!rhs.empty()) {
+      extend(rhs.min);
+      extend(rhs.max);
+    }
+  }
+};
+
 struct Vertex {
   Float3 position;
   Float3 normal;
   Float4 color;
 };
 
-using AddTriangleFunc = std::function<void(const Float4 &rgba, const Float3 &p0,
-                                           const Float3 &p1, const Float3 &p2)>;
+// Non-owning reference to a callable, like std::function_ref (C++26).
+// Never allocates. The callable must outlive the reference, so pass a lambda
+// directly or keep it in an `auto` variable. A function is held by its
+// address and never dangles.
+template <typename SIG> class FunctionRef;
+template <typename R, typename... ARGS> class FunctionRef<R(ARGS...)> {
+  union Target {
+    void *object;
+    R (*function)(ARGS...);
+  };
+  Target _target;
+  R (*_call)(Target, ARGS...);
+
+public:
+  template <typename F>
+    requires(!std::is_same_v<std::remove_cvref_t<F>, FunctionRef> &&
+             !std::is_function_v<std::remove_reference_t<F>> &&
+             std::is_invocable_r_v<R, F &, ARGS...>)
+  FunctionRef(F &&f)
+      : _target{.object = const_cast<void *>(
+                    static_cast<const void *>(std::addressof(f)))},
+        _call([](Target target, ARGS... args) -> R {
+          return (*static_cast<std::remove_reference_t<F> *>(target.object))(
+              std::forward<ARGS>(args)...);
+        }) {}
+
+  FunctionRef(R (*function)(ARGS...))
+      : _target{.function = function},
+        _call([](Target target, ARGS... args) -> R {
+          return target.function(std::forward<ARGS>(args)...);
+        }) {}
+
+  R operator()(ARGS... args) const {
+    return _call(_target, std::forward<ARGS>(args)...);
+  }
+};
+
+using AddTriangleRef = FunctionRef<void(const Float4 &rgba, const Float3 &p0,
+                                        const Float3 &p1, const Float3 &p2)>;
+
+// one gizmo component in its local space. the spans point at static
+// geometry that never changes, so a backend can upload it once and draw it
+// with model_matrix.
+struct MeshComponent {
+  std::span<const Vertex> vertices;
+  std::span<const UInt3> triangles;
+  Float4 color;
+};
+
+using AddMeshRef =
+    FunctionRef<void(const Float4x4 &model_matrix, const MeshComponent &mesh)>;
 
 struct Ray {
   Float3 origin;
@@ -310,6 +493,43 @@ struct Ray {
     return -(Float3::dot(plane.normal, this->origin) + plane.d) / denom;
   }
 
+  // slab test. hit_t is the entry distance (0 if the origin is inside)
+  bool intersect_aabb(const AABB &aabb, float *hit_t = nullptr) const {
+    if (aabb.empty()) {
+      return false;
+    }
+    float t_min = 0;
+    float t_max = std::numeric_limits<float>::infinity();
+    const float o[3] = {origin.x, origin.y, origin.z};
+    const float d[3] = {direction.x, direction.y, direction.z};
+    const float lo[3] = {aabb.min.x, aabb.min.y, aabb.min.z};
+    const float hi[3] = {aabb.max.x, aabb.max.y, aabb.max.z};
+    for (int i = 0; i < 3; ++i) {
+      if (std::abs(d[i]) == 0) {
+        // parallel to the slab
+        if (o[i] < lo[i] || o[i] > hi[i]) {
+          return false;
+        }
+        continue;
+      }
+      float inv = 1.0f / d[i];
+      float t0 = (lo[i] - o[i]) * inv;
+      float t1 = (hi[i] - o[i]) * inv;
+      if (t0 > t1) {
+        std::swap(t0, t1);
+      }
+      t_min = std::max(t_min, t0);
+      t_max = std::min(t_max, t1);
+      if (t_min > t_max) {
+        return false;
+      }
+    }
+    if (hit_t) {
+      *hit_t = t_min;
+    }
+    return true;
+  }
+
   bool intersect_triangle(const Float3 &v0, const Float3 &v1, const Float3 &v2,
                           float *hit_t) const {
     auto e1 = v1 - v0;
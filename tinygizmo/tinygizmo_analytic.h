@@ -0,0 +1,178 @@
+#pragma once
+#include "tinygizmo_alg.h"
+
+namespace tinygizmo {
+
+// Closed solids for picking without a mesh. They are the shapes the lathed
+// meshes approximate, so a hit agrees with MeshView::intersect up to the
+// chord error of the slices. t is in units of ray.direction, like
+// Ray::intersect_triangle, and a ray that starts inside hits the exit.
+
+// [begin, end] of t. empty if begin > end
+struct RayInterval {
+  float begin = -std::numeric_limits<float>::infinity();
+  float end = std::numeric_limits<float>::infinity();
+
+  bool empty() const { return this->begin > this->end; }
+
+  RayInterval clip(const RayInterval &rhs) const {
+    return {std::max(this->begin, rhs.begin), std::min(this->end, rhs.end)};
+  }
+
+  // the first surface in front of the origin. inf if none
+  float first_hit() const {
+    if (this->empty()) {
+      return std::numeric_limits<float>::infinity();
+    }
+    if (this->begin >= 0) {
+      return this->begin;
+    }
+    if (this->end >= 0) {
+      return this->end;
+    }
+    return std::numeric_limits<float>::infinity();
+  }
+
+  static RayInterval none() { return {1, 0}; }
+
+  // a t^2 + b t + c <= 0 where the solution is a single interval.
+  // a < 0 (two half lines) is left to the caller
+  static RayInterval quadratic(float a, float b, float c) {
+    if (a == 0) {
+      if (b == 0) {
+        return c <= 0 ? RayInterval{} : none();
+      }
+      float t = -c / b;
+      return b > 0 ? RayInterval{.end = t} : RayInterval{.begin = t};
+    }
+    float disc = b * b - 4 * a * c;
+    if (disc < 0) {
+      return none();
+    }
+    // the stable form of the two roots
+    float q = -0.5f * (b + std::copysign(std::sqrt(disc), b));
+    float t0 = q / a;
+    float t1 = q != 0 ? c / q : t0;
+    if (t0 > t1) {
+      std::swap(t0, t1);
+    }
+    return {t0, t1};
+  }
+};
+
+// the part of the ray between the planes at s0 and s1 along the unit axis
+inline RayInterval ray_slab(const Ray &ray, const Float3 &origin,
+                            const Float3 &axis, float s0, float s1) {
+  float s = Float3::dot(ray.origin - origin, axis);
+  float ds = Float3::dot(ray.direction, axis);
+  if (ds == 0) {
+    return (s >= s0 && s <= s1) ? RayInterval{} : RayInterval::none();
+  }
+  float t0 = (s0 - s) / ds;
+  float t1 = (s1 - s) / ds;
+  if (t0 > t1) {
+    std::swap(t0, t1);
+  }
+  return {t0, t1};
+}
+
+// the part of the ray inside the infinite cylinder around the unit axis
+inline RayInterval ray_cylinder(const Ray &ray, const Float3 &origin,
+                                const Float3 &axis, float radius) {
+  auto q = ray.origin - origin;
+  auto w = q - axis.scale(Float3::dot(q, axis));
+  auto v = ray.direction - axis.scale(Float3::dot(ray.direction, axis));
+  return RayInterval::quadratic(Float3::dot(v, v), 2 * Float3::dot(w, v),
+                                Float3::dot(w, w) - radius * radius);
+}
+
+struct AnalyticRing {
+  // a flat annulus with thickness: the lathe of a rectangle around axis
+  Float3 center;
+  Float3 axis;
+  float half_height;
+  float inner_radius;
+  float outer_radius;
+
+  float intersect(const Ray &ray) const {
+    auto solid = ray_slab(ray, this->center, this->axis, -this->half_height,
+                          this->half_height)
+                     .clip(ray_cylinder(ray, this->center, this->axis,
+                                        this->outer_radius));
+    if (solid.empty()) {
+      return solid.first_hit();
+    }
+    // minus the hole. what is left is up to two intervals
+    auto hole =
+        ray_cylinder(ray, this->center, this->axis, this->inner_radius);
+    if (hole.empty()) {
+      return solid.first_hit();
+    }
+    return std::min(
+        RayInterval{solid.begin, std::min(solid.end, hole.begin)}.first_hit(),
+        RayInterval{std::max(solid.begin, hole.end), solid.end}.first_hit());
+  }
+};
+
+struct AnalyticArrow {
+  // a shaft cylinder from shaft_begin to shaft_end along the unit axis and
+  // a head from shaft_end to head_end. the head is a cone, or a cylinder
+  // for the scaling maces
+  enum class Head {
+    Cone,
+    Cylinder,
+  };
+  Float3 axis;
+  float shaft_begin;
+  float shaft_end;
+  float shaft_radius;
+  float head_end;
+  float head_radius;
+  Head head = Head::Cone;
+
+  float intersect(const Ray &ray) const {
+    const Float3 origin = {0, 0, 0};
+    auto shaft =
+        ray_slab(ray, origin, this->axis, this->shaft_begin, this->shaft_end)
+            .clip(ray_cylinder(ray, origin, this->axis, this->shaft_radius));
+    auto head_slab =
+        ray_slab(ray, origin, this->axis, this->shaft_end, this->head_end);
+    auto head = this->head == Head::Cone
+                    ? head_slab.clip(ray_cone(ray, origin))
+                    : head_slab.clip(ray_cylinder(ray, origin, this->axis,
+                                                  this->head_radius));
+    return std::min(shaft.first_hit(), head.first_hit());
+  }
+
+private:
+  // radius head_radius at shaft_end, 0 at head_end. Solved as the double
+  // cone, which is the single one between the head planes.
+  RayInterval ray_cone(const Ray &ray, const Float3 &origin) const {
+    float k = this->head_radius / (this->head_end - this->shaft_end);
+    auto q = ray.origin - origin;
+    float qs = Float3::dot(q, this->axis);
+    float ds = Float3::dot(ray.direction, this->axis);
+    auto w = q - this->axis.scale(qs);
+    auto v = ray.direction - this->axis.scale(ds);
+    // |w + t v|^2 <= k^2 (head_end - s)^2
+    float h = this->head_end - qs;
+    float k2 = k * k;
+    float a = Float3::dot(v, v) - k2 * ds * ds;
+    float b = 2 * (Float3::dot(w, v) + k2 * h * ds);
+    float c = Float3::dot(w, w) - k2 * h * h;
+    if (a >= 0) {
+      return RayInterval::quadratic(a, b, c);
+    }
+    // two half lines. only one of them crosses the head slab
+    auto outside = RayInterval::quadratic(-a, -b, -c);
+    if (outside.empty()) {
+      return {};
+    }
+    auto slab =
+        ray_slab(ray, origin, this->axis, this->shaft_end, this->head_end);
+    auto before = slab.clip({.end = outside.begin});
+    return before.empty() ? slab.clip({.begin = outside.end}) : before;
+  }
+};
+
+} // namespace tinygizmo
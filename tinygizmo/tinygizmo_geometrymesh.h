@@ -1,39 +1,111 @@
+#pragma once
 #include "tinygizmo_alg.h"
+#include "tinygizmo_raycast.h"
+#include "tinygizmo_weld.h"
+#include <vector>
 
 namespace tinygizmo {
 
+// non-owning view of a gizmo mesh. GeometryMesh (built at runtime) and
+// StaticMesh (built at compile time) both hand out one of these
+struct MeshView {
+  std::span<const Vertex> vertices;
+  std::span<const UInt3> triangles;
+  // empty when the caller has no cache. intersect() walks the triangles
+  std::span<const TriangleBlock> triangle_blocks;
+  AABB bounds;
+  Float4 base_color;
+  Float4 highlight_color;
+
+  static Float3 transform_coord(const Float4x4 &m, const Float3 &coord) {
+    auto r = m.transform(Float4::make(coord, 1));
+    return r.xyz().scale(1.0 / r.w);
+  }
+
+  void add_triangles(const AddTriangleRef &add_triangle,
+                     const Float4x4 &modelMatrix, const Float4 &color) const {
+    for (auto &t : this->triangles) {
+      auto v0 = this->vertices[t.x];
+      auto v1 = this->vertices[t.y];
+      auto v2 = this->vertices[t.z];
+      auto p0 = transform_coord(
+          modelMatrix,
+          v0.position); // transform local coordinates into worldspace
+      auto p1 = transform_coord(
+          modelMatrix,
+          v1.position); // transform local coordinates into worldspace
+      auto p2 = transform_coord(
+          modelMatrix,
+          v2.position); // transform local coordinates into worldspace
+      add_triangle({color.x, color.y, color.z, color.w}, {p0.x, p0.y, p0.z},
+                   {p1.x, p1.y, p1.z}, {p2.x, p2.y, p2.z});
+    }
+  }
+
+  void add_mesh(const AddMeshRef &add_mesh, const Float4x4 &modelMatrix,
+                const Float4 &color) const {
+    add_mesh(modelMatrix, {
+                              .vertices = this->vertices,
+                              .triangles = this->triangles,
+                              .color = color,
+                          });
+  }
+
+  float intersect(const Ray &ray) const {
+    float best_t = std::numeric_limits<float>::infinity();
+    if (!ray.intersect_aabb(this->bounds)) {
+      return best_t;
+    }
+    if (!this->triangle_blocks.empty()) {
+      return TriangleCache::intersect_blocks(ray, this->triangle_blocks.data(),
+                                             this->triangle_blocks.size());
+    }
+    // slow path through the index buffer
+    for (auto &tri : this->triangles) {
+      float t;
+      if (ray.intersect_triangle(this->vertices[tri.x].position,
+                                 this->vertices[tri.y].position,
+                                 this->vertices[tri.z].position, &t) &&
+          t < best_t) {
+        best_t = t;
+      }
+    }
+    return best_t;
+  }
+};
+
 struct GeometryMesh {
   std::vector<Vertex> vertices;
   std::vector<UInt3> triangles;
   Float4 base_color;
   Float4 highlight_color;
+  // local space bounds. intersect() skips the triangles when the ray misses
+  AABB bounds;
+  // SoA copy of the triangles for intersect()
+  TriangleCache triangle_cache;
+
+  void compute_bounds() {
+    this->bounds = {};
+    for (auto &v : this->vertices) {
+      this->bounds.extend(v.position);
+    }
+  }
+
+  // call after editing vertices or triangles
+  void build_intersect_cache() {
+    compute_bounds();
+    this->triangle_cache.build(this->vertices, this->triangles);
+  }
 
   void compute_normals() {
     static const double NORMAL_EPSILON = 0.0001;
 
-    std::vector<uint32_t> uniqueVertIndices(this->vertices.size(), 0);
-    for (uint32_t i = 0; i < uniqueVertIndices.size(); ++i) {
-      if (uniqueVertIndices[i] == 0) {
-        uniqueVertIndices[i] = i + 1;
-        auto v0 = this->vertices[i].position;
-        for (auto j = i + 1; j < this->vertices.size(); ++j) {
-          auto v1 = this->vertices[j].position;
-          if ((v1 - v0).length2() < NORMAL_EPSILON) {
-            uniqueVertIndices[j] = uniqueVertIndices[i];
-          }
-        }
-      }
-    }
+    auto uniqueVertIndices = weld_vertices(this->vertices, NORMAL_EPSILON);
 
-    uint32_t idx0, idx1, idx2;
     for (auto &t : this->triangles) {
-      idx0 = uniqueVertIndices[t.x] - 1;
-      idx1 = uniqueVertIndices[t.y] - 1;
-      idx2 = uniqueVertIndices[t.z] - 1;
-
-      auto &v0 = this->vertices[idx0];
-      auto &v1 = this->vertices[idx1];
-      auto &v2 = this->vertices[idx2];
+      auto &v0 = this->vertices[uniqueVertIndices[t.x]];
+      auto &v1 = this->vertices[uniqueVertIndices[t.y]];
+      auto &v2 = this->vertices[uniqueVertIndices[t.z]];
       auto n =
           Float3::cross(v1.position - v0.position, v2.position - v0.position);
       v0.normal = v0.normal + n;
@@ -42,8 +114,7 @@ struct GeometryMesh {
     }
 
     for (uint32_t i = 0; i < this->vertices.size(); ++i) {
-      this->vertices[i].normal =
-          this->vertices[uniqueVertIndices[i] - 1].normal;
+      this->vertices[i].normal = this->vertices[uniqueVertIndices[i]].normal;
     }
     for (auto &v : this->vertices) {
       v.normal = v.normal.normalize();
@@ -76,6 +147,7 @@ struct GeometryMesh {
     mesh.triangles = {{0, 1, 2},    {0, 2, 3},    {4, 5, 6},    {4, 6, 7},
                       {8, 9, 10},   {8, 10, 11},  {12, 13, 14}, {12, 14, 15},
                       {16, 17, 18}, {16, 18, 19}, {20, 21, 22}, {20, 22, 23}};
+    mesh.build_intersect_cache();
     return mesh;
   }
 
@@ -113,6 +185,7 @@ struct GeometryMesh {
       mesh.triangles.push_back({base, base + i * 2 - 2, base + i * 2});
       mesh.triangles.push_back({base + 1, base + i * 2 + 1, base + i * 2 - 1});
     }
+    mesh.build_intersect_cache();
     return mesh;
   }
 
@@ -166,49 +239,35 @@ struct GeometryMesh {
       }
     }
     mesh.compute_normals();
+    mesh.build_intersect_cache();
     return mesh;
   }
 
-  static Float3 transform_coord(const Float4x4 &m, const Float3 &coord) {
-    auto r = m.transform(Float4::make(coord, 1));
-    return r.xyz().scale(1.0 / r.w);
+  MeshView view() const {
+    bool cached = this->triangle_cache.triangle_count == this->triangles.size();
+    return {
+        .vertices = this->vertices,
+        .triangles = this->triangles,
+        .triangle_blocks = cached ? std::span<const TriangleBlock>(
+                                        this->triangle_cache.blocks)
+                                  : std::span<const TriangleBlock>(),
+        .bounds = this->bounds,
+        .base_color = this->base_color,
+        .highlight_color = this->highlight_color,
+    };
   }
 
-  void add_triangles(const AddTriangleFunc &add_triangle,
+  void add_triangles(const AddTriangleRef &add_triangle,
                      const Float4x4 &modelMatrix, const Float4 &color) const {
-    for (auto &t : this->triangles) {
-      auto v0 = this->vertices[t.x];
-      auto v1 = this->vertices[t.y];
-      auto v2 = this->vertices[t.z];
-      auto p0 = transform_coord(
-          modelMatrix,
-          v0.position); // transform local coordinates into worldspace
-      auto p1 = transform_coord(
-          modelMatrix,
-          v1.position); // transform local coordinates into worldspace
-      auto p2 = transform_coord(
-          modelMatrix,
-          v2.position); // transform local coordinates into worldspace
-      add_triangle({color.x, color.y, color.z, color.w}, {p0.x, p0.y, p0.z},
-                   {p1.x, p1.y, p1.z}, {p2.x, p2.y, p2.z});
-    }
+    view().add_triangles(add_triangle, modelMatrix, color);
   }
 
-  float intersect(const Ray &ray) const {
-    float best_t = std::numeric_limits<float>::infinity();
-    std::optional<int32_t> best_tri = {};
-    for (auto &tri : this->triangles) {
-      float t;
-      if (ray.intersect_triangle(this->vertices[tri.x].position,
-                                 this->vertices[tri.y].position,
-                                 this->vertices[tri.z].position, &t) &&
-          t < best_t) {
-        best_t = t;
-        best_tri = uint32_t(&tri - this->triangles.data());
-      }
-    }
-    return best_t;
+  void add_mesh(const AddMeshRef &add_mesh, const Float4x4 &modelMatrix,
+                const Float4 &color) const {
+    view().add_mesh(add_mesh, modelMatrix, color);
   }
+
+  float intersect(const Ray &ray) const { return view().intersect(ray); }
 };
 
 } // namespace tinygizmo
@@ -0,0 +1,108 @@
+#include "tinygizmo.h"
+#include <thread>
+
+namespace tinygizmo {
+
+// fewer members than this per thread are not worth a thread
+static constexpr size_t MEMBERS_PER_THREAD = 4096;
+
+void GroupDrag::begin(std::span<const Transform> selection,
+                      const Transform &active, Pivot pivot) {
+  const auto n = selection.size();
+  for (auto *v : {&this->px, &this->py, &this->pz, &this->qx, &this->qy,
+                  &this->qz, &this->qw, &this->sx, &this->sy, &this->sz}) {
+    v->resize(n);
+  }
+  Float3 sum = {0, 0, 0};
+  for (size_t i = 0; i < n; ++i) {
+    auto &t = selection[i];
+    this->px[i] = t.position.x;
+    this->py[i] = t.position.y;
+    this->pz[i] = t.position.z;
+    this->qx[i] = t.orientation.x;
+    this->qy[i] = t.orientation.y;
+    this->qz[i] = t.orientation.z;
+    this->qw[i] = t.orientation.w;
+    this->sx[i] = t.scale.x;
+    this->sy[i] = t.scale.y;
+    this->sz[i] = t.scale.z;
+    sum = sum + t.position;
+  }
+  this->active = active;
+  this->pivot = (pivot == Pivot::Centroid && n > 0)
+                    ? sum.scale(1.0f / static_cast<float>(n))
+                    : active.position;
+}
+
+void GroupDrag::apply(const Transform &active_dst, std::span<Transform> dst,
+                      unsigned threads) const {
+  // the delta of the active transform
+  const auto &src = this->active;
+  const Quaternion q = active_dst.orientation * src.orientation.inverse();
+  const Float3 ratio = {
+      active_dst.scale.x / src.scale.x,
+      active_dst.scale.y / src.scale.y,
+      active_dst.scale.z / src.scale.z,
+  };
+  // the pivot follows the translation, the members turn and scale around it
+  const Float3 c = this->pivot;
+  const Float3 moved = c + (active_dst.position - src.position);
+
+  // m: offset from the pivot -> new offset. scale along the axes of the
+  // active transform, then rotate
+  Float3 m[3];
+  const Quaternion to_local = src.orientation.conjugage();
+  const Quaternion to_world = q * src.orientation;
+  for (int k = 0; k < 3; ++k) {
+    Float3 e = {k == 0 ? 1.0f : 0, k == 1 ? 1.0f : 0, k == 2 ? 1.0f : 0};
+    m[k] = to_world.rotate(to_local.rotate(e).mult_each(ratio));
+  }
+
+  auto run = [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+      const float ox = this->px[i] - c.x;
+      const float oy = this->py[i] - c.y;
+      const float oz = this->pz[i] - c.z;
+      auto &t = dst[i];
+      t.position = {
+          moved.x + m[0].x * ox + m[1].x * oy + m[2].x * oz,
+          moved.y + m[0].y * ox + m[1].y * oy + m[2].y * oz,
+          moved.z + m[0].z * ox + m[1].z * oy + m[2].z * oz,
+      };
+      const float bx = this->qx[i], by = this->qy[i], bz = this->qz[i],
+                  bw = this->qw[i];
+      t.orientation = {
+          q.x * bw + q.w * bx + q.y * bz - q.z * by,
+          q.y * bw + q.w * by + q.z * bx - q.x * bz,
+          q.z * bw + q.w * bz + q.x * by - q.y * bx,
+          q.w * bw - q.x * bx - q.y * by - q.z * bz,
+      };
+      t.scale = {
+          this->sx[i] * ratio.x,
+          this->sy[i] * ratio.y,
+          this->sz[i] * ratio.z,
+      };
+    }
+  };
+
+  const size_t n = std::min(this->size(), dst.size());
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, n / MEMBERS_PER_THREAD));
+  if (threads <= 1) {
+    run(0, n);
+    return;
+  }
+  std::vector<std::thread> workers;
+  workers.reserve(threads);
+  const size_t per_thread = (n + threads - 1) / threads;
+  for (unsigned i = 0; i < threads; ++i) {
+    const size_t begin = i * per_thread;
+    const size_t end = std::min(n, begin + per_thread);
+    workers.emplace_back(run, begin, end);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+} // namespace tinygizmo
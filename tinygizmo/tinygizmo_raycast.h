@@ -0,0 +1,247 @@
+#pragma once
+#include "tinygizmo_alg.h"
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define TINYGIZMO_RAYCAST_AVX
+#elif defined(__SSE2__) || defined(_M_X64) ||                                  \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TINYGIZMO_RAYCAST_SSE
+#endif
+
+namespace tinygizmo {
+
+// Möller–Trumbore against pre-expanded triangles.
+// Triangles are stored as v0 and the two edges (e1 = v1 - v0, e2 = v2 - v0)
+// in blocks of 8 lanes (AoSoA), so one block is one AVX or two SSE loads per
+// component. Unused lanes are zero (degenerate) and never hit.
+struct TriangleBlock {
+  static constexpr uint32_t WIDTH = 8;
+  alignas(32) float v0x[WIDTH];
+  alignas(32) float v0y[WIDTH];
+  alignas(32) float v0z[WIDTH];
+  alignas(32) float e1x[WIDTH];
+  alignas(32) float e1y[WIDTH];
+  alignas(32) float e1z[WIDTH];
+  alignas(32) float e2x[WIDTH];
+  alignas(32) float e2y[WIDTH];
+  alignas(32) float e2z[WIDTH];
+
+  constexpr void set(uint32_t lane, const Float3 &v0, const Float3 &v1,
+                     const Float3 &v2) {
+    auto e1 = v1 - v0;
+    auto e2 = v2 - v0;
+    v0x[lane] = v0.x;
+    v0y[lane] = v0.y;
+    v0z[lane] = v0.z;
+    e1x[lane] = e1.x;
+    e1y[lane] = e1.y;
+    e1z[lane] = e1.z;
+    e2x[lane] = e2.x;
+    e2y[lane] = e2.y;
+    e2z[lane] = e2.z;
+  }
+};
+
+struct TriangleCache {
+  std::vector<TriangleBlock> blocks;
+  uint32_t triangle_count = 0;
+
+  void build(const std::vector<Vertex> &vertices,
+             const std::vector<UInt3> &triangles) {
+    this->triangle_count = (uint32_t)triangles.size();
+    this->blocks.assign(
+        (triangles.size() + TriangleBlock::WIDTH - 1) / TriangleBlock::WIDTH,
+        TriangleBlock{});
+    for (uint32_t i = 0; i < triangles.size(); ++i) {
+      auto &t = triangles[i];
+      this->blocks[i / TriangleBlock::WIDTH].set(
+          i % TriangleBlock::WIDTH, vertices[t.x].position,
+          vertices[t.y].position, vertices[t.z].position);
+    }
+  }
+
+  // same acceptance rules as Ray::intersect_triangle.
+  // returns the nearest t or infinity
+  static float intersect_block_scalar(const Ray &ray,
+                                      const TriangleBlock &b) {
+    float best_t = std::numeric_limits<float>::infinity();
+    for (uint32_t i = 0; i < TriangleBlock::WIDTH; ++i) {
+      Float3 e1{b.e1x[i], b.e1y[i], b.e1z[i]};
+      Float3 e2{b.e2x[i], b.e2y[i], b.e2z[i]};
+      auto h = Float3::cross(ray.direction, e2);
+      auto a = Float3::dot(e1, h);
+      if (std::abs(a) == 0) {
+        continue;
+      }
+      float f = 1 / a;
+      auto s = ray.origin - Float3{b.v0x[i], b.v0y[i], b.v0z[i]};
+      auto u = f * Float3::dot(s, h);
+      if (u < 0 || u > 1) {
+        continue;
+      }
+      auto q = Float3::cross(s, e1);
+      auto v = f * Float3::dot(ray.direction, q);
+      if (v < 0 || u + v > 1) {
+        continue;
+      }
+      auto t = f * Float3::dot(e2, q);
+      if (t < 0) {
+        continue;
+      }
+      if (t < best_t) {
+        best_t = t;
+      }
+    }
+    return best_t;
+  }
+
+#if defined(TINYGIZMO_RAYCAST_AVX)
+  static float intersect_blocks(const Ray &ray, const TriangleBlock *blocks,
+                                size_t count) {
+    const __m256 ox = _mm256_set1_ps(ray.origin.x);
+    const __m256 oy = _mm256_set1_ps(ray.origin.y);
+    const __m256 oz = _mm256_set1_ps(ray.origin.z);
+    const __m256 dx = _mm256_set1_ps(ray.direction.x);
+    const __m256 dy = _mm256_set1_ps(ray.direction.y);
+    const __m256 dz = _mm256_set1_ps(ray.direction.z);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256 best = inf;
+    for (size_t i = 0; i < count; ++i) {
+      auto &b = blocks[i];
+      __m256 e1x = _mm256_load_ps(b.e1x), e1y = _mm256_load_ps(b.e1y),
+             e1z = _mm256_load_ps(b.e1z);
+      __m256 e2x = _mm256_load_ps(b.e2x), e2y = _mm256_load_ps(b.e2y),
+             e2z = _mm256_load_ps(b.e2z);
+      // h = cross(d, e2)
+      __m256 hx =
+          _mm256_sub_ps(_mm256_mul_ps(dy, e2z), _mm256_mul_ps(dz, e2y));
+      __m256 hy =
+          _mm256_sub_ps(_mm256_mul_ps(dz, e2x), _mm256_mul_ps(dx, e2z));
+      __m256 hz =
+          _mm256_sub_ps(_mm256_mul_ps(dx, e2y), _mm256_mul_ps(dy, e2x));
+      __m256 a = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(e1x, hx), _mm256_mul_ps(e1y, hy)),
+          _mm256_mul_ps(e1z, hz));
+      __m256 reject = _mm256_cmp_ps(a, zero, _CMP_EQ_OQ);
+      __m256 f = _mm256_div_ps(one, a);
+      // s = o - v0
+      __m256 sx = _mm256_sub_ps(ox, _mm256_load_ps(b.v0x));
+      __m256 sy = _mm256_sub_ps(oy, _mm256_load_ps(b.v0y));
+      __m256 sz = _mm256_sub_ps(oz, _mm256_load_ps(b.v0z));
+      __m256 u = _mm256_mul_ps(
+          f, _mm256_add_ps(
+                 _mm256_add_ps(_mm256_mul_ps(sx, hx), _mm256_mul_ps(sy, hy)),
+                 _mm256_mul_ps(sz, hz)));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(u, zero, _CMP_LT_OQ));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(u, one, _CMP_GT_OQ));
+      // q = cross(s, e1)
+      __m256 qx =
+          _mm256_sub_ps(_mm256_mul_ps(sy, e1z), _mm256_mul_ps(sz, e1y));
+      __m256 qy =
+          _mm256_sub_ps(_mm256_mul_ps(sz, e1x), _mm256_mul_ps(sx, e1z));
+      __m256 qz =
+          _mm256_sub_ps(_mm256_mul_ps(sx, e1y), _mm256_mul_ps(sy, e1x));
+      __m256 v = _mm256_mul_ps(
+          f, _mm256_add_ps(
+                 _mm256_add_ps(_mm256_mul_ps(dx, qx), _mm256_mul_ps(dy, qy)),
+                 _mm256_mul_ps(dz, qz)));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(v, zero, _CMP_LT_OQ));
+      reject = _mm256_or_ps(
+          reject, _mm256_cmp_ps(_mm256_add_ps(u, v), one, _CMP_GT_OQ));
+      __m256 t = _mm256_mul_ps(
+          f, _mm256_add_ps(
+                 _mm256_add_ps(_mm256_mul_ps(e2x, qx), _mm256_mul_ps(e2y, qy)),
+                 _mm256_mul_ps(e2z, qz)));
+      reject = _mm256_or_ps(reject, _mm256_cmp_ps(t, zero, _CMP_LT_OQ));
+      // min_ps returns the second operand for NaN, so NaN never wins
+      best = _mm256_min_ps(_mm256_blendv_ps(t, inf, reject), best);
+    }
+    __m128 m = _mm_min_ps(_mm256_castps256_ps128(best),
+                          _mm256_extractf128_ps(best, 1));
+    m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+  }
+#elif defined(TINYGIZMO_RAYCAST_SSE)
+  static float intersect_blocks(const Ray &ray, const TriangleBlock *blocks,
+                                size_t count) {
+    const __m128 ox = _mm_set1_ps(ray.origin.x);
+    const __m128 oy = _mm_set1_ps(ray.origin.y);
+    const __m128 oz = _mm_set1_ps(ray.origin.z);
+    const __m128 dx = _mm_set1_ps(ray.direction.x);
+    const __m128 dy = _mm_set1_ps(ray.direction.y);
+    const __m128 dz = _mm_set1_ps(ray.direction.z);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 best = inf;
+    for (size_t i = 0; i < count; ++i) {
+      auto &b = blocks[i];
+      for (uint32_t l = 0; l < TriangleBlock::WIDTH; l += 4) {
+        __m128 e1x = _mm_load_ps(b.e1x + l), e1y = _mm_load_ps(b.e1y + l),
+               e1z = _mm_load_ps(b.e1z + l);
+        __m128 e2x = _mm_load_ps(b.e2x + l), e2y = _mm_load_ps(b.e2y + l),
+               e2z = _mm_load_ps(b.e2z + l);
+        // h = cross(d, e2)
+        __m128 hx = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 hy = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 hz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 a = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(e1x, hx), _mm_mul_ps(e1y, hy)),
+            _mm_mul_ps(e1z, hz));
+        __m128 reject = _mm_cmpeq_ps(a, zero);
+        __m128 f = _mm_div_ps(one, a);
+        // s = o - v0
+        __m128 sx = _mm_sub_ps(ox, _mm_load_ps(b.v0x + l));
+        __m128 sy = _mm_sub_ps(oy, _mm_load_ps(b.v0y + l));
+        __m128 sz = _mm_sub_ps(oz, _mm_load_ps(b.v0z + l));
+        __m128 u = _mm_mul_ps(
+            f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, hx), _mm_mul_ps(sy, hy)),
+                          _mm_mul_ps(sz, hz)));
+        reject = _mm_or_ps(reject, _mm_cmplt_ps(u, zero));
+        reject = _mm_or_ps(reject, _mm_cmpgt_ps(u, one));
+        // q = cross(s, e1)
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(
+            f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+                          _mm_mul_ps(dz, qz)));
+        reject = _mm_or_ps(reject, _mm_cmplt_ps(v, zero));
+        reject = _mm_or_ps(reject, _mm_cmpgt_ps(_mm_add_ps(u, v), one));
+        __m128 t = _mm_mul_ps(
+            f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)),
+                          _mm_mul_ps(e2z, qz)));
+        reject = _mm_or_ps(reject, _mm_cmplt_ps(t, zero));
+        // min_ps returns the second operand for NaN, so NaN never wins
+        __m128 candidate =
+            _mm_or_ps(_mm_and_ps(reject, inf), _mm_andnot_ps(reject, t));
+        best = _mm_min_ps(candidate, best);
+      }
+    }
+    __m128 m = _mm_min_ps(best, _mm_movehl_ps(best, best));
+    m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+    return _mm_cvtss_f32(m);
+  }
+#else
+  static float intersect_blocks(const Ray &ray, const TriangleBlock *blocks,
+                                size_t count) {
+    float best_t = std::numeric_limits<float>::infinity();
+    for (size_t i = 0; i < count; ++i) {
+      best_t = std::min(best_t, intersect_block_scalar(ray, blocks[i]));
+    }
+    return best_t;
+  }
+#endif
+
+  float intersect(const Ray &ray) const {
+    return intersect_blocks(ray, this->blocks.data(), this->blocks.size());
+  }
+};
+
+} // namespace tinygizmo
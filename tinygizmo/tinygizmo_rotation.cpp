@@ -1,43 +1,85 @@
 #include "tinygizmo_rotation.h"
-#include "tinygizmo_geometrymesh.h"
+#include "tinygizmo_analytic.h"
+#include "tinygizmo_staticmesh.h"
 #include <assert.h>
 #include <optional>
 #include <stdexcept>
 
 namespace tinygizmo {
 
-std::vector<Float2> ring_points = {
-    {+0.025f, 1},    {-0.025f, 1},    {-0.025f, 1},    {-0.025f, 1.1f},
-    {-0.025f, 1.1f}, {+0.025f, 1.1f}, {+0.025f, 1.1f}, {+0.025f, 1}};
+constexpr std::array<Float2, 8> ring_points = {
+    {{+0.025f, 1},
+     {-0.025f, 1},
+     {-0.025f, 1},
+     {-0.025f, 1.1f},
+     {-0.025f, 1.1f},
+     {+0.025f, 1.1f},
+     {+0.025f, 1.1f},
+     {+0.025f, 1}}};
 
-auto _rotate_x = GeometryMesh::make_lathed_geometry(
-    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 32, ring_points,
-    Float4{1, 0.5f, 0.5f, 1.f}, Float4{1, 0, 0, 1.f}, 0.003f);
+constexpr auto _rotate_x = make_lathed_lod(
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, ring_points, Float4{1, 0.5f, 0.5f, 1.f},
+    Float4{1, 0, 0, 1.f}, 0.003f);
 
-auto _rotate_y = GeometryMesh::make_lathed_geometry(
-    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, 32, ring_points,
-    Float4{0.5f, 1, 0.5f, 1.f}, Float4{0, 1, 0, 1.f}, -0.003f);
+constexpr auto _rotate_y = make_lathed_lod(
+    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, ring_points, Float4{0.5f, 1, 0.5f, 1.f},
+    Float4{0, 1, 0, 1.f}, -0.003f);
 
-auto _rotate_z = GeometryMesh::make_lathed_geometry(
-    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, 32, ring_points,
-    Float4{0.5f, 0.5f, 1, 1.f}, Float4{0, 0, 1, 1.f});
+constexpr auto _rotate_z = make_lathed_lod(
+    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, ring_points, Float4{0.5f, 0.5f, 1, 1.f},
+    Float4{0, 0, 1, 1.f});
 
-static auto _gizmo_components = {
-    std::make_pair(RotationGizmo::GizmoComponentType::RotationX, _rotate_x),
-    std::make_pair(RotationGizmo::GizmoComponentType::RotationY, _rotate_y),
-    std::make_pair(RotationGizmo::GizmoComponentType::RotationZ, _rotate_z),
+// the rings default to LOD_SLICES[2] = 32 slices
+constexpr std::pair<RotationGizmo::GizmoComponentType, LodMeshView>
+    _gizmo_components[] = {
+        {RotationGizmo::GizmoComponentType::RotationX, _rotate_x.view(2)},
+        {RotationGizmo::GizmoComponentType::RotationY, _rotate_y.view(2)},
+        {RotationGizmo::GizmoComponentType::RotationZ, _rotate_z.view(2)},
 };
 
+// the rings as solids for PickMode::Analytic. ring_points is a 0.05 thick
+// band from radius 1 to 1.1, shifted by the same eps as the meshes
+constexpr std::pair<RotationGizmo::GizmoComponentType, AnalyticRing>
+    _analytic_components[] = {
+        {RotationGizmo::GizmoComponentType::RotationX,
+         {{0.003f, 0.003f, 0.003f}, {1, 0, 0}, 0.025f, 1, 1.1f}},
+        {RotationGizmo::GizmoComponentType::RotationY,
+         {{-0.003f, -0.003f, -0.003f}, {0, 1, 0}, 0.025f, 1, 1.1f}},
+        {RotationGizmo::GizmoComponentType::RotationZ,
+         {{0, 0, 0}, {0, 0, 1}, 0.025f, 1, 1.1f}},
+};
+
+static const AnalyticRing *
+analytic_ring(RotationGizmo::GizmoComponentType component) {
+  for (auto &[c, ring] : _analytic_components) {
+    if (c == component) {
+      return &ring;
+    }
+  }
+  return nullptr;
+}
+
+// union of the component bounds. rejects a missing ray before any mesh test
+constexpr AABB _gizmo_bounds = [] {
+  AABB bounds;
+  for (auto &[component, mesh] : _gizmo_components) {
+    bounds.extend(mesh.bounds());
+  }
+  return bounds;
+}();
+
 void rotation_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<RotationGizmo::GizmoComponentType> active_component) {
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<RotationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
 
   // std::vector<std::shared_ptr<GizmoComponent>> draw_interactions;
   // if (!state.local_toggle && this->active)
   //   draw_interactions = {interaction_mode(this->active)};
   // else
 
-  for (auto &[component, mesh] : _gizmo_components) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
     mesh.add_triangles(add_world_triangle, modelMatrix,
                        (component == active_component) ? mesh.base_color
                                                        : mesh.highlight_color);
@@ -88,12 +130,33 @@ void rotation_mesh(
   //
 }
 
+void rotation_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<RotationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
+    mesh.add_mesh(add_mesh, modelMatrix,
+                  (component == active_component) ? mesh.base_color
+                                                  : mesh.highlight_color);
+  }
+}
+
+const AABB &rotation_bounds() { return _gizmo_bounds; }
+
 std::tuple<std::optional<RotationGizmo::GizmoComponentType>, float>
-rotation_intersect(const Ray &ray) {
+rotation_intersect(const Ray &ray, float pixels_per_unit,
+                   PickMode pick_mode) {
   float best_t = std::numeric_limits<float>::infinity();
+  if (!ray.intersect_aabb(_gizmo_bounds)) {
+    return {std::nullopt, best_t};
+  }
   std::optional<RotationGizmo::GizmoComponentType> updated_state = {};
-  for (auto &[component, mesh] : _gizmo_components) {
-    float t = mesh.intersect(ray);
+  for (auto &[component, lod] : _gizmo_components) {
+    auto ring =
+        pick_mode == PickMode::Analytic ? analytic_ring(component) : nullptr;
+    float t = ring ? ring->intersect(ray)
+                   : lod.select(pixels_per_unit).intersect(ray);
     if (t < best_t) {
       updated_state = component;
       best_t = t;
@@ -102,14 +165,21 @@ rotation_intersect(const Ray &ray) {
   return {updated_state, best_t};
 }
 
+// the rotation of from onto to around axis, by a multiple of angle. the
+// signed angle keeps the axis defined when from and to are opposite
 inline Quaternion
 make_rotation_quat_between_vectors_snapped(const Float3 &from, const Float3 &to,
+                                           const Float3 &axis,
                                            const float angle) {
   auto a = from.normalize();
   auto b = to.normalize();
-  auto snappedAcos = std::floor(std::acos(Float3::dot(a, b)) / angle) * angle;
-  return Quaternion::from_axis_angle(Float3::cross(a, b).normalize(),
-                                     snappedAcos);
+  auto signed_angle =
+      std::atan2(Float3::dot(Float3::cross(a, b), axis), Float3::dot(a, b));
+  auto snapped = snap(signed_angle, angle);
+  if (snapped == 0) {
+    return {0, 0, 0, 1};
+  }
+  return Quaternion::from_axis_angle(axis, snapped);
 }
 
 static Float3 click_offset(const RayState &ray_state) {
@@ -118,34 +188,67 @@ static Float3 click_offset(const RayState &ray_state) {
                                              ray.direction.scale(ray_state.t));
 }
 
-static std::optional<Quaternion> axis_rotation_dragger(const FrameState &frame,
-                                                       const RayState &drag,
-                                                       const Float3 &axis,
-                                                       const Transform &src) {
-  assert(frame.mouse_down);
+static Quaternion start_orientation(const RayState &drag) {
+  return drag.local_toggle ? drag.transform.orientation
+                           : Quaternion{0, 0, 0, 1};
+}
+
+void rotation_drag_begin(RotationGizmo::GizmoComponentType active_component,
+                         const FrameState &frame, RayState &drag) {
+  Float3 axis;
+  switch (active_component) {
+  case RotationGizmo::GizmoComponentType::RotationX:
+    axis = {1, 0, 0};
+    break;
+
+  case RotationGizmo::GizmoComponentType::RotationY:
+    axis = {0, 1, 0};
+    break;
 
-  auto start_orientation =
-      drag.local_toggle ? drag.transform.orientation : Quaternion{0, 0, 0, 1};
+  case RotationGizmo::GizmoComponentType::RotationZ:
+    axis = {0, 0, 1};
+    break;
+
+  default:
+    assert(false);
+    throw std::runtime_error("unknown rotation");
+  }
 
   Transform original_pose = {
-      start_orientation,
+      start_orientation(drag),
       drag.transform.position,
   };
-  auto the_axis = original_pose.transform_vector(axis);
-  auto the_plane =
-      Plane::from_normal_and_position(the_axis, click_offset(drag));
+  auto &cache = drag.cache;
+  cache.axis = original_pose.transform_vector(axis);
+  cache.click = click_offset(drag);
+  cache.plane = Plane::from_normal_and_position(cache.axis, cache.click);
+  cache.center = drag.transform.position +
+                 cache.axis.scale(Float3::dot(
+                     cache.axis, cache.click - drag.transform.position));
+  cache.arm = (cache.click - cache.center).normalize();
+}
+
+std::optional<Quaternion>
+rotation_drag(RotationGizmo::GizmoComponentType active_component,
+              const FrameState &frame, const RayState &drag,
+              const Transform &src) {
+  assert(frame.mouse_down);
 
-  auto t = frame.ray.intersect_plane(the_plane);
+  auto &cache = drag.cache;
+  auto t = frame.ray.intersect_plane(cache.plane);
   if (!t) {
     return {};
   }
 
-  auto center_of_rotation =
-      drag.transform.position +
-      the_axis.scale(
-          Float3::dot(the_axis, click_offset(drag) - drag.transform.position));
-  auto arm1 = (click_offset(drag) - center_of_rotation).normalize();
-  auto arm2 = (frame.ray.point(*t) - center_of_rotation).normalize();
+  auto arm1 = cache.arm;
+  auto arm2 = (frame.ray.point(*t) - cache.center).normalize();
+
+  if (frame.snap_rotation > 0) {
+    // back to the start orientation below half a step
+    return make_rotation_quat_between_vectors_snapped(
+               arm1, arm2, cache.axis, frame.snap_rotation) *
+           start_orientation(drag);
+  }
 
   float d = Float3::dot(arm1, arm2);
   if (d > 0.999f) {
@@ -158,27 +261,7 @@ static std::optional<Quaternion> axis_rotation_dragger(const FrameState &frame,
   }
 
   auto a = Float3::cross(arm1, arm2).normalize();
-  return Quaternion::from_axis_angle(a, angle) * start_orientation;
-}
-
-std::optional<Quaternion>
-rotation_drag(RotationGizmo::GizmoComponentType active_component,
-              const FrameState &frame, const RayState &drag,
-              const Transform &src) {
-  switch (active_component) {
-  case RotationGizmo::GizmoComponentType::RotationX:
-    return axis_rotation_dragger(frame, drag, {1, 0, 0}, src);
-
-  case RotationGizmo::GizmoComponentType::RotationY:
-    return axis_rotation_dragger(frame, drag, {0, 1, 0}, src);
-
-  case RotationGizmo::GizmoComponentType::RotationZ:
-    return axis_rotation_dragger(frame, drag, {0, 0, 1}, src);
-
-  default:
-    assert(false);
-    throw std::runtime_error("unknown rotation");
-  }
+  return Quaternion::from_axis_angle(a, angle) * start_orientation(drag);
 }
 
 } // namespace tinygizmo
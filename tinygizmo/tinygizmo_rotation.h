@@ -4,11 +4,25 @@
 namespace tinygizmo {
 
 void rotation_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<RotationGizmo::GizmoComponentType> active_component);
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<RotationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
+
+void rotation_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<RotationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
 
 std::tuple<std::optional<RotationGizmo::GizmoComponentType>, float>
-rotation_intersect(const Ray &ray);
+rotation_intersect(const Ray &ray, float pixels_per_unit = 0,
+                   PickMode pick_mode = PickMode::Mesh);
+
+// local space bounds of all components
+const AABB &rotation_bounds();
+
+// fills drag.cache for the component that intersect picked
+void rotation_drag_begin(RotationGizmo::GizmoComponentType active_component,
+                         const FrameState &frame, RayState &drag);
 
 std::optional<Quaternion>
 rotation_drag(RotationGizmo::GizmoComponentType active_component,
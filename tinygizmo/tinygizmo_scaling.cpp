@@ -1,5 +1,6 @@
 #include "tinygizmo_scaling.h"
-#include "tinygizmo_geometrymesh.h"
+#include "tinygizmo_analytic.h"
+#include "tinygizmo_staticmesh.h"
 #include <assert.h>
 #include <stdexcept>
 
@@ -9,43 +10,105 @@ template <typename T> T clamp(const T &val, const T &min, const T &max) {
   return std::min(std::max(val, min), max);
 }
 
-std::vector<Float2> mace_points = {{0.25f, 0}, {0.25f, 0.05f}, {1, 0.05f},
-                                   {1, 0.1f},  {1.25f, 0.1f},  {1.25f, 0}};
-
-auto _scale_x = GeometryMesh::make_lathed_geometry(
-    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 16, mace_points,
-    Float4{1, 0.5f, 0.5f, 1.f}, Float4{1, 0, 0, 1.f});
+constexpr std::array<Float2, 6> mace_points = {{{0.25f, 0},
+                                                {0.25f, 0.05f},
+                                                {1, 0.05f},
+                                                {1, 0.1f},
+                                                {1.25f, 0.1f},
+                                                {1.25f, 0}}};
+
+constexpr auto _scale_x = make_lathed_lod(
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, mace_points, Float4{1, 0.5f, 0.5f, 1.f},
+    Float4{1, 0, 0, 1.f});
+
+constexpr auto _scale_y = make_lathed_lod(
+    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, mace_points, Float4{0.5f, 1, 0.5f, 1.f},
+    Float4{0, 1, 0, 1.f});
+
+constexpr auto _scale_z = make_lathed_lod(
+    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, mace_points, Float4{0.5f, 0.5f, 1, 1.f},
+    Float4{0, 0, 1, 1.f});
+
+// the maces default to LOD_SLICES[1] = 16 slices
+constexpr std::pair<ScalingGizmo::GizmoComponentType, LodMeshView>
+    _gizmo_components[] = {
+        {ScalingGizmo::GizmoComponentType::ScalingX, _scale_x.view(1)},
+        {ScalingGizmo::GizmoComponentType::ScalingY, _scale_y.view(1)},
+        {ScalingGizmo::GizmoComponentType::ScalingZ, _scale_z.view(1)},
+};
 
-auto _scale_y = GeometryMesh::make_lathed_geometry(
-    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, 16, mace_points,
-    Float4{0.5f, 1, 0.5f, 1.f}, Float4{0, 1, 0, 1.f});
+// the maces as solids for PickMode::Analytic, from mace_points
+constexpr std::pair<ScalingGizmo::GizmoComponentType, AnalyticArrow>
+    _analytic_components[] = {
+        {ScalingGizmo::GizmoComponentType::ScalingX,
+         {{1, 0, 0}, 0.25f, 1, 0.05f, 1.25f, 0.1f,
+          AnalyticArrow::Head::Cylinder}},
+        {ScalingGizmo::GizmoComponentType::ScalingY,
+         {{0, 1, 0}, 0.25f, 1, 0.05f, 1.25f, 0.1f,
+          AnalyticArrow::Head::Cylinder}},
+        {ScalingGizmo::GizmoComponentType::ScalingZ,
+         {{0, 0, 1}, 0.25f, 1, 0.05f, 1.25f, 0.1f,
+          AnalyticArrow::Head::Cylinder}},
+};
 
-auto _scale_z = GeometryMesh::make_lathed_geometry(
-    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, 16, mace_points,
-    Float4{0.5f, 0.5f, 1, 1.f}, Float4{0, 0, 1, 1.f});
+static const AnalyticArrow *
+analytic_mace(ScalingGizmo::GizmoComponentType component) {
+  for (auto &[c, mace] : _analytic_components) {
+    if (c == component) {
+      return &mace;
+    }
+  }
+  return nullptr;
+}
 
-auto _gizmo_components = {
-    std::make_pair(ScalingGizmo::GizmoComponentType::ScalingX, _scale_x),
-    std::make_pair(ScalingGizmo::GizmoComponentType::ScalingY, _scale_y),
-    std::make_pair(ScalingGizmo::GizmoComponentType::ScalingZ, _scale_z),
-};
+// union of the component bounds. rejects a missing ray before any mesh test
+constexpr AABB _gizmo_bounds = [] {
+  AABB bounds;
+  for (auto &[component, mesh] : _gizmo_components) {
+    bounds.extend(mesh.bounds());
+  }
+  return bounds;
+}();
 
 void scaling_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<ScalingGizmo::GizmoComponentType> active_component) {
-  for (auto &[component, mesh] : _gizmo_components) {
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<ScalingGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
     mesh.add_triangles(add_world_triangle, modelMatrix,
                        (component == active_component) ? mesh.base_color
                                                        : mesh.highlight_color);
   }
 }
 
+void scaling_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<ScalingGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
+    mesh.add_mesh(add_mesh, modelMatrix,
+                  (component == active_component) ? mesh.base_color
+                                                  : mesh.highlight_color);
+  }
+}
+
+const AABB &scaling_bounds() { return _gizmo_bounds; }
+
 std::tuple<std::optional<ScalingGizmo::GizmoComponentType>, float>
-scaling_intersect(const Ray &ray) {
+scaling_intersect(const Ray &ray, float pixels_per_unit,
+                  PickMode pick_mode) {
   float best_t = std::numeric_limits<float>::infinity();
+  if (!ray.intersect_aabb(_gizmo_bounds)) {
+    return {std::nullopt, best_t};
+  }
   std::optional<ScalingGizmo::GizmoComponentType> updated_state = {};
-  for (auto &[component, mesh] : _gizmo_components) {
-    float t = mesh.intersect(ray);
+  for (auto &[component, lod] : _gizmo_components) {
+    auto mace =
+        pick_mode == PickMode::Analytic ? analytic_mace(component) : nullptr;
+    float t = mace ? mace->intersect(ray)
+                   : lod.select(pixels_per_unit).intersect(ray);
     if (t < best_t) {
       updated_state = component;
       best_t = t;
@@ -69,33 +132,53 @@ static Float3 click_offset(const RayState &ray_state) {
                                              ray.direction.scale(ray_state.t));
 }
 
-static std::optional<Float3> axis_scale_dragger(const FrameState &frame,
-                                                const RayState &drag,
-                                                const Float3 &axis,
-                                                const Transform &src) {
-  assert(frame.mouse_down);
+void scaling_drag_begin(ScalingGizmo::GizmoComponentType active_component,
+                        const FrameState &frame, RayState &drag) {
+  auto &cache = drag.cache;
+  switch (active_component) {
+  case ScalingGizmo::GizmoComponentType::ScalingX:
+    cache.axis = {1, 0, 0};
+    break;
 
-  auto plane_tangent = Float3::cross(axis, src.position - frame.ray.origin);
-  auto plane_normal = Float3::cross(axis, plane_tangent);
+  case ScalingGizmo::GizmoComponentType::ScalingY:
+    cache.axis = {0, 1, 0};
+    break;
 
-  // Define the plane to contain the original position of the object
-  auto plane_point = src.position;
+  case ScalingGizmo::GizmoComponentType::ScalingZ:
+    cache.axis = {0, 0, 1};
+    break;
 
-  // If an intersection exists between the ray and the plane, place the
-  // object at that point
-  auto denom = Float3::dot(frame.ray.direction, plane_normal);
-  if (std::abs(denom) == 0) {
-    return {};
+  default:
+    assert(false);
+    throw std::runtime_error("unknown scaling");
   }
 
-  auto t = Float3::dot(plane_point - frame.ray.origin, plane_normal) / denom;
-  if (t < 0) {
+  auto &position = drag.transform.position;
+  auto plane_tangent = Float3::cross(cache.axis, position - frame.ray.origin);
+  auto plane_normal = Float3::cross(cache.axis, plane_tangent);
+  // Define the plane to contain the original position of the object. not
+  // normalized: a zero normal (the ray along the axis) never intersects
+  cache.plane = {plane_normal, -Float3::dot(plane_normal, position)};
+  cache.click = click_offset(drag);
+}
+
+std::optional<Float3>
+scaling_drag(ScalingGizmo::GizmoComponentType active_component,
+             const FrameState &frame, const RayState &drag,
+             const Transform &src) {
+  assert(frame.mouse_down);
+
+  // If an intersection exists between the ray and the plane, place the
+  // object at that point
+  auto &cache = drag.cache;
+  auto t = frame.ray.intersect_plane(cache.plane);
+  if (!t || *t < 0) {
     return {};
   }
 
-  auto distance = frame.ray.point(t);
+  auto distance = frame.ray.point(*t);
 
-  auto offset_on_axis = (distance - click_offset(drag)).mult_each(axis);
+  auto offset_on_axis = (distance - cache.click).mult_each(cache.axis);
   flush_to_zero(offset_on_axis);
   Float3 new_scale = drag.transform.scale + offset_on_axis;
 
@@ -108,33 +191,20 @@ static std::optional<Float3> axis_scale_dragger(const FrameState &frame,
   : Float3{clamp(new_scale.x, 0.01f, 1000.f),
     clamp(new_scale.y, 0.01f, 1000.f),
     clamp(new_scale.z, 0.01f, 1000.f),};
-  return scale;
-}
-
-std::optional<Float3>
-scaling_drag(ScalingGizmo::GizmoComponentType active_component,
-             const FrameState &frame, const RayState &drag,
-             const Transform &src) {
-  // auto scale = src.scale;
-  Transform _src{
-      .orientation = {0, 0, 0, 1},
-      .position = src.position,
-      .scale = src.scale,
-  };
-  switch (active_component) {
-  case ScalingGizmo::GizmoComponentType::ScalingX:
-    return axis_scale_dragger(frame, drag, {1, 0, 0}, _src);
-
-  case ScalingGizmo::GizmoComponentType::ScalingY:
-    return axis_scale_dragger(frame, drag, {0, 1, 0}, _src);
-
-  case ScalingGizmo::GizmoComponentType::ScalingZ:
-    return axis_scale_dragger(frame, drag, {0, 0, 1}, _src);
-
-  default:
-    assert(false);
-    throw std::runtime_error("unknown scaling");
+  if (const float step = frame.snap_scale; step > 0) {
+    // the dragged components, never below one step
+    auto snap_scale = [&](float value, float axis) {
+      return (drag.uniform || axis != 0)
+                 ? clamp(snap(value, step), step, std::max(1000.f, step))
+                 : value;
+    };
+    scale = {
+        snap_scale(scale.x, cache.axis.x),
+        snap_scale(scale.y, cache.axis.y),
+        snap_scale(scale.z, cache.axis.z),
+    };
   }
+  return scale;
 }
 
 } // namespace tinygizmo
@@ -4,11 +4,25 @@
 namespace tinygizmo {
 
 void scaling_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<ScalingGizmo::GizmoComponentType> active_component);
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<ScalingGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
+
+void scaling_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<ScalingGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
 
 std::tuple<std::optional<ScalingGizmo::GizmoComponentType>, float>
-scaling_intersect(const Ray &ray);
+scaling_intersect(const Ray &ray, float pixels_per_unit = 0,
+                  PickMode pick_mode = PickMode::Mesh);
+
+// local space bounds of all components
+const AABB &scaling_bounds();
+
+// fills drag.cache for the component that intersect picked
+void scaling_drag_begin(ScalingGizmo::GizmoComponentType active_component,
+                        const FrameState &frame, RayState &drag);
 
 std::optional<Float3>
 scaling_drag(ScalingGizmo::GizmoComponentType active_component,
@@ -0,0 +1,240 @@
+#include "tinygizmo.h"
+#include <array>
+#include <numeric>
+
+namespace tinygizmo {
+
+// the default cell holds about this many vertices of a surface mesh
+static constexpr float VERTICES_PER_CELL = 32;
+
+using Cell = std::array<int32_t, 3>;
+
+static Cell cell_of(const Float3 &p, float cell) {
+  return {grid_cell(p.x, cell), grid_cell(p.y, cell), grid_cell(p.z, cell)};
+}
+
+// 21 bits per axis, as weld_vertices. cells that alias share a bucket, which
+// only costs a few extra distance tests
+static uint64_t key_of(int32_t x, int32_t y, int32_t z) {
+  return (static_cast<uint64_t>(x & 0x1fffff) << 42) |
+         (static_cast<uint64_t>(y & 0x1fffff) << 21) |
+         static_cast<uint64_t>(z & 0x1fffff);
+}
+
+// sorts values by key. cells: key -> [begin, end) of values
+template <typename T>
+static void
+bucket(const std::vector<uint64_t> &keys, std::vector<T> &values,
+       std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> &cells) {
+  std::vector<uint32_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+  std::vector<T> sorted(values.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    sorted[i] = values[order[i]];
+  }
+  values = std::move(sorted);
+
+  cells.clear();
+  cells.reserve(order.size());
+  for (uint32_t begin = 0; begin < order.size();) {
+    auto end = begin + 1;
+    while (end < order.size() && keys[order[end]] == keys[order[begin]]) {
+      ++end;
+    }
+    cells.emplace(keys[order[begin]], std::make_pair(begin, end));
+    begin = end;
+  }
+}
+
+// Calls visit(begin, end) for the buckets around p, nearest ring first.
+// best2 is the squared distance of the best candidate so far, visit lowers
+// it. Stops when the rings left are all farther away.
+template <typename F>
+static void visit_rings(
+    const std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> &cells,
+    const Float3 &p, float cell, float radius, const float &best2,
+    const F &visit) {
+  auto c = cell_of(p, cell);
+  auto rings = static_cast<int32_t>(std::ceil(radius / cell));
+  auto visit_cell = [&](int32_t dx, int32_t dy, int32_t dz) {
+    auto found = cells.find(key_of(c[0] + dx, c[1] + dy, c[2] + dz));
+    if (found != cells.end()) {
+      visit(found->second.first, found->second.second);
+    }
+  };
+  for (int32_t k = 0; k <= rings; ++k) {
+    for (int32_t dx = -k; dx <= k; ++dx) {
+      for (int32_t dy = -k; dy <= k; ++dy) {
+        if (std::abs(dx) == k || std::abs(dy) == k) {
+          for (int32_t dz = -k; dz <= k; ++dz) {
+            visit_cell(dx, dy, dz);
+          }
+        } else if (k > 0) {
+          visit_cell(dx, dy, -k);
+          visit_cell(dx, dy, k);
+        }
+      }
+    }
+    // a point in ring k + 1 is at least k cells away
+    float reach = k * cell;
+    if (best2 <= reach * reach) {
+      break;
+    }
+  }
+}
+
+// the rings of the radius have more cells than there are items
+static bool prefer_scan(float radius, float cell, size_t items) {
+  auto side = 2 * std::ceil(radius / cell) + 1;
+  return side * side * side > static_cast<float>(items);
+}
+
+// Real-Time Collision Detection 5.1.5
+static Float3 closest_point_on_triangle(const Float3 &p, const Float3 &a,
+                                        const Float3 &b, const Float3 &c) {
+  auto ab = b - a;
+  auto ac = c - a;
+  auto ap = p - a;
+  float d1 = Float3::dot(ab, ap);
+  float d2 = Float3::dot(ac, ap);
+  if (d1 <= 0 && d2 <= 0) {
+    return a;
+  }
+  auto bp = p - b;
+  float d3 = Float3::dot(ab, bp);
+  float d4 = Float3::dot(ac, bp);
+  if (d3 >= 0 && d4 <= d3) {
+    return b;
+  }
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+    return a + ab.scale(d1 / (d1 - d3));
+  }
+  auto cp = p - c;
+  float d5 = Float3::dot(ab, cp);
+  float d6 = Float3::dot(ac, cp);
+  if (d6 >= 0 && d5 <= d6) {
+    return c;
+  }
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+    return a + ac.scale(d2 / (d2 - d6));
+  }
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) {
+    return b + (c - b).scale((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+  }
+  float denom = 1.0f / (va + vb + vc);
+  return a + ab.scale(vb * denom) + ac.scale(vc * denom);
+}
+
+void SnapIndex::build(std::span<const Float3> positions,
+                      std::span<const uint32_t> indices, float cell) {
+  this->bounds = {};
+  for (auto &p : positions) {
+    this->bounds.extend(p);
+  }
+  if (!(cell > 0)) {
+    auto size = this->bounds.max - this->bounds.min;
+    float extent = std::max({size.x, size.y, size.z});
+    // a surface: the vertex count grows with the square of the cells
+    cell = extent / std::max(1.0f, std::sqrt(positions.size() /
+                                             VERTICES_PER_CELL));
+    if (!(cell > 0)) {
+      cell = 1;
+    }
+  }
+  this->cell = cell;
+
+  std::vector<uint64_t> keys;
+  keys.reserve(positions.size());
+  for (auto &p : positions) {
+    auto c = cell_of(p, cell);
+    keys.push_back(key_of(c[0], c[1], c[2]));
+  }
+  this->vertices.assign(positions.begin(), positions.end());
+  bucket(keys, this->vertices, this->vertex_cells);
+
+  this->positions.assign(positions.begin(), positions.end());
+  this->indices.assign(indices.begin(), indices.end());
+  keys.clear();
+  this->triangle_refs.clear();
+  for (uint32_t t = 0; t + 2 < this->indices.size(); t += 3) {
+    AABB aabb;
+    for (uint32_t i = 0; i < 3; ++i) {
+      aabb.extend(this->positions[this->indices[t + i]]);
+    }
+    auto min = cell_of(aabb.min, cell);
+    auto max = cell_of(aabb.max, cell);
+    for (int32_t x = min[0]; x <= max[0]; ++x) {
+      for (int32_t y = min[1]; y <= max[1]; ++y) {
+        for (int32_t z = min[2]; z <= max[2]; ++z) {
+          keys.push_back(key_of(x, y, z));
+          this->triangle_refs.push_back(t);
+        }
+      }
+    }
+  }
+  bucket(keys, this->triangle_refs, this->triangle_cells);
+}
+
+std::optional<Float3> SnapIndex::nearest_vertex(const Float3 &p,
+                                                float radius) const {
+  std::optional<Float3> best;
+  float best2 = radius * radius;
+  auto test = [&](uint32_t begin, uint32_t end) {
+    for (auto i = begin; i < end; ++i) {
+      float d2 = (this->vertices[i] - p).length2();
+      if (d2 <= best2) {
+        best2 = d2;
+        best = this->vertices[i];
+      }
+    }
+  };
+  if (this->empty() || !(radius >= 0)) {
+    return best;
+  }
+  if (prefer_scan(radius, this->cell, this->vertices.size())) {
+    test(0, static_cast<uint32_t>(this->vertices.size()));
+  } else {
+    visit_rings(this->vertex_cells, p, this->cell, radius, best2, test);
+  }
+  return best;
+}
+
+std::optional<Float3> SnapIndex::nearest_surface(const Float3 &p,
+                                                 float radius) const {
+  std::optional<Float3> best;
+  float best2 = radius * radius;
+  auto test_triangle = [&](uint32_t t) {
+    auto q = closest_point_on_triangle(p, this->positions[this->indices[t]],
+                                       this->positions[this->indices[t + 1]],
+                                       this->positions[this->indices[t + 2]]);
+    float d2 = (q - p).length2();
+    if (d2 <= best2) {
+      best2 = d2;
+      best = q;
+    }
+  };
+  if (this->indices.empty() || !(radius >= 0)) {
+    return best;
+  }
+  const auto triangle_count = this->indices.size() / 3;
+  if (prefer_scan(radius, this->cell, triangle_count)) {
+    for (uint32_t t = 0; t + 2 < this->indices.size(); t += 3) {
+      test_triangle(t);
+    }
+  } else {
+    visit_rings(this->triangle_cells, p, this->cell, radius, best2,
+                [&](uint32_t begin, uint32_t end) {
+                  for (auto i = begin; i < end; ++i) {
+                    test_triangle(this->triangle_refs[i]);
+                  }
+                });
+  }
+  return best;
+}
+
+} // namespace tinygizmo
@@ -0,0 +1,346 @@
+#pragma once
+#include "tinygizmo_geometrymesh.h"
+#include <algorithm>
+#include <array>
+#include <iterator>
+
+namespace tinygizmo {
+
+// std::sin/cos/sqrt are not constexpr before C++26.
+// double precision series, rounded to float by the caller.
+namespace cx {
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr double sqrt(double x) {
+  if (!(x > 0)) {
+    return 0;
+  }
+  double curr = x > 1 ? x : 1;
+  double prev = 0;
+  while (curr != prev) {
+    prev = curr;
+    curr = 0.5 * (curr + x / curr);
+    if (curr >= prev) {
+      // converged (newton approaches the root from above)
+      return prev;
+    }
+  }
+  return curr;
+}
+
+constexpr double sin(double x) {
+  // reduce to [-PI, PI]
+  while (x > PI) {
+    x -= 2 * PI;
+  }
+  while (x < -PI) {
+    x += 2 * PI;
+  }
+  double term = x;
+  double sum = x;
+  for (int i = 1; i < 16; ++i) {
+    term *= -x * x / ((2 * i) * (2 * i + 1));
+    sum += term;
+  }
+  return sum;
+}
+
+constexpr double cos(double x) { return sin(x + PI / 2); }
+
+constexpr Float3 normalize(const Float3 &v) {
+  auto l = v.length2();
+  if (l == 0) {
+    return v;
+  }
+  return v.scale(1.0f / (float)sqrt(l));
+}
+
+} // namespace cx
+
+// A mesh baked at compile time into static storage. No allocation and no
+// dynamic initialisation, so it is safe to use from any translation unit at
+// any time. view() is the same MeshView a GeometryMesh hands out.
+template <size_t VERTEX_COUNT, size_t TRIANGLE_COUNT> struct StaticMesh {
+  static constexpr size_t BLOCK_COUNT =
+      (TRIANGLE_COUNT + TriangleBlock::WIDTH - 1) / TriangleBlock::WIDTH;
+
+  std::array<Vertex, VERTEX_COUNT> vertices = {};
+  std::array<UInt3, TRIANGLE_COUNT> triangles = {};
+  std::array<TriangleBlock, BLOCK_COUNT> triangle_blocks = {};
+  AABB bounds;
+  Float4 base_color = {};
+  Float4 highlight_color = {};
+
+  // GeometryMesh::compute_normals, welding with the same NORMAL_EPSILON.
+  // Same result as the pairwise weld, but the candidates come from a sweep
+  // along the longest axis so that the 64 slice meshes stay cheap to bake.
+  constexpr void compute_normals() {
+    constexpr double NORMAL_EPSILON = 0.0001;
+    // a little larger than the radius, as in weld_vertices
+    const float window = static_cast<float>(cx::sqrt(NORMAL_EPSILON) * 1.01);
+
+    AABB extent;
+    for (auto &v : this->vertices) {
+      extent.extend(v.position);
+    }
+    auto size = extent.max - extent.min;
+    auto axis_of = [axis = size.x >= size.y && size.x >= size.z ? 0
+                           : size.y >= size.z                   ? 1
+                                                                : 2](
+                       const Float3 &p) {
+      return axis == 0 ? p.x : axis == 1 ? p.y : p.z;
+    };
+
+    std::array<uint32_t, VERTEX_COUNT> order = {};
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      auto pa = axis_of(this->vertices[a].position);
+      auto pb = axis_of(this->vertices[b].position);
+      return pa < pb || (pa == pb && a < b);
+    });
+
+    std::array<uint32_t, VERTEX_COUNT> uniqueVertIndices = {};
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+      if (uniqueVertIndices[i] == 0) {
+        uniqueVertIndices[i] = i + 1;
+        auto v0 = this->vertices[i].position;
+        auto begin = std::lower_bound(
+            order.begin(), order.end(), axis_of(v0) - window,
+            [&](uint32_t j, float value) {
+              return axis_of(this->vertices[j].position) < value;
+            });
+        for (auto it = begin; it != order.end(); ++it) {
+          auto j = *it;
+          auto v1 = this->vertices[j].position;
+          if (axis_of(v1) > axis_of(v0) + window) {
+            break;
+          }
+          if (j > i && (v1 - v0).length2() < NORMAL_EPSILON) {
+            uniqueVertIndices[j] = uniqueVertIndices[i];
+          }
+        }
+      }
+    }
+
+    for (auto &t : this->triangles) {
+      auto &v0 = this->vertices[uniqueVertIndices[t.x] - 1];
+      auto &v1 = this->vertices[uniqueVertIndices[t.y] - 1];
+      auto &v2 = this->vertices[uniqueVertIndices[t.z] - 1];
+      auto n =
+          Float3::cross(v1.position - v0.position, v2.position - v0.position);
+      v0.normal = v0.normal + n;
+      v1.normal = v1.normal + n;
+      v2.normal = v2.normal + n;
+    }
+
+    for (uint32_t i = 0; i < VERTEX_COUNT; ++i) {
+      this->vertices[i].normal =
+          this->vertices[uniqueVertIndices[i] - 1].normal;
+    }
+    for (auto &v : this->vertices) {
+      v.normal = cx::normalize(v.normal);
+    }
+  }
+
+  constexpr void build_intersect_cache() {
+    this->bounds = {};
+    for (auto &v : this->vertices) {
+      this->bounds.extend(v.position);
+    }
+    for (uint32_t i = 0; i < TRIANGLE_COUNT; ++i) {
+      auto &t = this->triangles[i];
+      this->triangle_blocks[i / TriangleBlock::WIDTH].set(
+          i % TriangleBlock::WIDTH, this->vertices[t.x].position,
+          this->vertices[t.y].position, this->vertices[t.z].position);
+    }
+  }
+
+  constexpr MeshView view() const {
+    return {
+        .vertices = this->vertices,
+        .triangles = this->triangles,
+        .triangle_blocks = this->triangle_blocks,
+        .bounds = this->bounds,
+        .base_color = this->base_color,
+        .highlight_color = this->highlight_color,
+    };
+  }
+};
+
+template <size_t SLICES, size_t POINTS>
+using LathedMesh =
+    StaticMesh<(SLICES + 1) * POINTS, SLICES * (POINTS - 1) * 2>;
+
+// GeometryMesh::make_lathed_geometry at compile time
+template <size_t SLICES, size_t POINTS>
+constexpr LathedMesh<SLICES, POINTS>
+make_lathed_mesh(const Float3 &axis, const Float3 &arm1, const Float3 &arm2,
+                 const std::array<Float2, POINTS> &points,
+                 const Float4 &base_color, const Float4 &highlight_color,
+                 const float eps = 0.0f) {
+  const float tau = 6.28318530718f;
+
+  LathedMesh<SLICES, POINTS> mesh;
+  mesh.base_color = base_color;
+  mesh.highlight_color = highlight_color;
+  uint32_t v = 0;
+  uint32_t t = 0;
+  for (uint32_t i = 0; i <= SLICES; ++i) {
+    const float angle =
+        (static_cast<float>(i % SLICES) * tau / SLICES) + (tau / 8.f);
+    const float c = (float)cx::cos(angle), s = (float)cx::sin(angle);
+    auto row1 = arm1.scale(c) + arm2.scale(s);
+    for (auto &p : points) {
+      auto position = axis.scale(p.x) + row1.scale(p.y);
+      mesh.vertices[v++] = {
+          .position = position + Float3{eps, eps, eps},
+          .normal = {0, 0, 0},
+      };
+    }
+
+    if (i > 0) {
+      for (uint32_t j = 1; j < (uint32_t)POINTS; ++j) {
+        uint32_t i0 = (i - 1) * uint32_t(POINTS) + (j - 1);
+        uint32_t i1 = (i - 0) * uint32_t(POINTS) + (j - 1);
+        uint32_t i2 = (i - 0) * uint32_t(POINTS) + (j - 0);
+        uint32_t i3 = (i - 1) * uint32_t(POINTS) + (j - 0);
+        mesh.triangles[t++] = {i0, i1, i2};
+        mesh.triangles[t++] = {i0, i2, i3};
+      }
+    }
+  }
+  mesh.compute_normals();
+  mesh.build_intersect_cache();
+  return mesh;
+}
+
+// Level of detail. A lathed component is baked once per slice count and
+// the level drawn and picked is chosen from its size on screen.
+constexpr size_t LOD_SLICES[] = {8, 16, 32, 64};
+constexpr size_t LOD_COUNT = std::size(LOD_SLICES);
+
+struct LodMeshView {
+  std::array<MeshView, LOD_COUNT> levels;
+  // distance of the lathe profile from its axis. 0 if all levels are the same
+  float radius = 0;
+  // used when the size on screen is unknown
+  size_t default_level = 0;
+
+  // a mesh without levels, like a box
+  static constexpr LodMeshView fixed(const MeshView &view) {
+    LodMeshView lod;
+    lod.levels.fill(view);
+    return lod;
+  }
+
+  // pixels_per_unit: FrameState::pixels_per_unit, or 0 for default_level.
+  // The first level whose chord error stays under a pixel. A circle of r
+  // pixels cut into n slices is off by r * (1 - cos(PI / n)) ~ r * PI^2 /
+  // (2 * n^2) at most.
+  constexpr const MeshView &select(float pixels_per_unit) const {
+    if (!(pixels_per_unit > 0)) {
+      return this->levels[this->default_level];
+    }
+    const double r = this->radius * pixels_per_unit;
+    for (size_t i = 0; i < LOD_COUNT; ++i) {
+      double n = static_cast<double>(LOD_SLICES[i]);
+      if (r * cx::PI * cx::PI <= 2 * n * n) {
+        return this->levels[i];
+      }
+    }
+    return this->levels[LOD_COUNT - 1];
+  }
+
+  constexpr AABB bounds() const {
+    AABB bounds;
+    for (auto &level : this->levels) {
+      bounds.extend(level.bounds);
+    }
+    return bounds;
+  }
+};
+
+// one LathedMesh per LOD_SLICES
+template <size_t POINTS> struct LathedLod {
+  LathedMesh<LOD_SLICES[0], POINTS> level0;
+  LathedMesh<LOD_SLICES[1], POINTS> level1;
+  LathedMesh<LOD_SLICES[2], POINTS> level2;
+  LathedMesh<LOD_SLICES[3], POINTS> level3;
+  float radius;
+
+  constexpr LodMeshView view(size_t default_level) const {
+    return {
+        .levels = {this->level0.view(), this->level1.view(),
+                   this->level2.view(), this->level3.view()},
+        .radius = this->radius,
+        .default_level = default_level,
+    };
+  }
+};
+
+template <size_t POINTS>
+constexpr LathedLod<POINTS>
+make_lathed_lod(const Float3 &axis, const Float3 &arm1, const Float3 &arm2,
+                const std::array<Float2, POINTS> &points,
+                const Float4 &base_color, const Float4 &highlight_color,
+                const float eps = 0.0f) {
+  float radius = 0;
+  for (auto &p : points) {
+    radius = std::max(radius, p.y < 0 ? -p.y : p.y);
+  }
+  return {
+      .level0 = make_lathed_mesh<LOD_SLICES[0]>(
+          axis, arm1, arm2, points, base_color, highlight_color, eps),
+      .level1 = make_lathed_mesh<LOD_SLICES[1]>(
+          axis, arm1, arm2, points, base_color, highlight_color, eps),
+      .level2 = make_lathed_mesh<LOD_SLICES[2]>(
+          axis, arm1, arm2, points, base_color, highlight_color, eps),
+      .level3 = make_lathed_mesh<LOD_SLICES[3]>(
+          axis, arm1, arm2, points, base_color, highlight_color, eps),
+      .radius = radius,
+  };
+}
+
+// GeometryMesh::make_box_geometry at compile time
+constexpr StaticMesh<24, 12> make_box_mesh(const Float3 &min_bounds,
+                                           const Float3 &max_bounds,
+                                           const Float4 &base_color,
+                                           const Float4 &highlight_color) {
+  const auto a = min_bounds, b = max_bounds;
+  StaticMesh<24, 12> mesh;
+  mesh.base_color = base_color;
+  mesh.highlight_color = highlight_color;
+  mesh.vertices = {{
+      {{a.x, a.y, a.z}, {-1, 0, 0}}, {{a.x, a.y, b.z}, {-1, 0, 0}},
+      {{a.x, b.y, b.z}, {-1, 0, 0}}, {{a.x, b.y, a.z}, {-1, 0, 0}},
+      {{b.x, a.y, a.z}, {+1, 0, 0}}, {{b.x, b.y, a.z}, {+1, 0, 0}},
+      {{b.x, b.y, b.z}, {+1, 0, 0}}, {{b.x, a.y, b.z}, {+1, 0, 0}},
+      {{a.x, a.y, a.z}, {0, -1, 0}}, {{b.x, a.y, a.z}, {0, -1, 0}},
+      {{b.x, a.y, b.z}, {0, -1, 0}}, {{a.x, a.y, b.z}, {0, -1, 0}},
+      {{a.x, b.y, a.z}, {0, +1, 0}}, {{a.x, b.y, b.z}, {0, +1, 0}},
+      {{b.x, b.y, b.z}, {0, +1, 0}}, {{b.x, b.y, a.z}, {0, +1, 0}},
+      {{a.x, a.y, a.z}, {0, 0, -1}}, {{a.x, b.y, a.z}, {0, 0, -1}},
+      {{b.x, b.y, a.z}, {0, 0, -1}}, {{b.x, a.y, a.z}, {0, 0, -1}},
+      {{a.x, a.y, b.z}, {0, 0, +1}}, {{b.x, a.y, b.z}, {0, 0, +1}},
+      {{b.x, b.y, b.z}, {0, 0, +1}}, {{a.x, b.y, b.z}, {0, 0, +1}},
+  }};
+  mesh.triangles = {{{0, 1, 2},
+                     {0, 2, 3},
+                     {4, 5, 6},
+                     {4, 6, 7},
+                     {8, 9, 10},
+                     {8, 10, 11},
+                     {12, 13, 14},
+                     {12, 14, 15},
+                     {16, 17, 18},
+                     {16, 18, 19},
+                     {20, 21, 22},
+                     {20, 22, 23}}};
+  mesh.build_intersect_cache();
+  return mesh;
+}
+
+} // namespace tinygizmo
@@ -1,69 +1,126 @@
 #include "tinygizmo_translation.h"
-#include "tinygizmo_geometrymesh.h"
+#include "tinygizmo_analytic.h"
+#include "tinygizmo_staticmesh.h"
 #include <assert.h>
 #include <optional>
 #include <stdexcept>
 
 namespace tinygizmo {
 
-std::vector<Float2> arrow_points = {
-    {0.25f, 0}, {0.25f, 0.05f}, {1, 0.05f}, {1, 0.10f}, {1.2f, 0}};
-
-auto _translate_x = GeometryMesh::make_lathed_geometry(
-    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, 16, arrow_points,
-    Float4{1, 0.5f, 0.5f, 1.f}, Float4{1, 0, 0, 1.f});
-auto _translate_y = GeometryMesh::make_lathed_geometry(
-    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, 16, arrow_points,
-    Float4{0.5f, 1, 0.5f, 1.f}, Float4{0, 1, 0, 1.f});
-auto _translate_z = GeometryMesh::make_lathed_geometry(
-    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, 16, arrow_points,
-    Float4{0.5f, 0.5f, 1, 1.f}, Float4{0, 0, 1, 1.f});
-auto _translate_yz = GeometryMesh::make_box_geometry(
-    {-0.01f, 0.25, 0.25}, {0.01f, 0.75f, 0.75f}, Float4{0.5f, 1, 1, 0.5f},
-    Float4{0, 1, 1, 0.6f});
-auto _translate_zx = GeometryMesh::make_box_geometry(
-    {0.25, -0.01f, 0.25}, {0.75f, 0.01f, 0.75f}, Float4{1, 0.5f, 1, 0.5f},
-    Float4{1, 0, 1, 0.6f});
-auto _translate_xy = GeometryMesh::make_box_geometry(
-    {0.25, 0.25, -0.01f}, {0.75f, 0.75f, 0.01f}, Float4{1, 1, 0.5f, 0.5f},
-    Float4{1, 1, 0, 0.6f});
-auto _translate_xyz = GeometryMesh::make_box_geometry(
-    {-0.05f, -0.05f, -0.05f}, {0.05f, 0.05f, 0.05f},
-    Float4{0.9f, 0.9f, 0.9f, 0.25f}, Float4{1, 1, 1, 0.35f});
-
-static auto _gizmo_components = {
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationX,
-                   _translate_x),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationY,
-                   _translate_y),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationZ,
-                   _translate_z),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationYZ,
-                   _translate_yz),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationZX,
-                   _translate_zx),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationXY,
-                   _translate_xy),
-    std::make_pair(TranslationGizmo::GizmoComponentType::TranslationView,
-                   _translate_xyz),
+constexpr std::array<Float2, 5> arrow_points = {
+    {{0.25f, 0}, {0.25f, 0.05f}, {1, 0.05f}, {1, 0.10f}, {1.2f, 0}}};
+
+constexpr auto _translate_x = make_lathed_lod(
+    {1, 0, 0}, {0, 1, 0}, {0, 0, 1}, arrow_points, Float4{1, 0.5f, 0.5f, 1.f},
+    Float4{1, 0, 0, 1.f});
+constexpr auto _translate_y = make_lathed_lod(
+    {0, 1, 0}, {0, 0, 1}, {1, 0, 0}, arrow_points, Float4{0.5f, 1, 0.5f, 1.f},
+    Float4{0, 1, 0, 1.f});
+constexpr auto _translate_z = make_lathed_lod(
+    {0, 0, 1}, {1, 0, 0}, {0, 1, 0}, arrow_points, Float4{0.5f, 0.5f, 1, 1.f},
+    Float4{0, 0, 1, 1.f});
+constexpr auto _translate_yz =
+    make_box_mesh({-0.01f, 0.25, 0.25}, {0.01f, 0.75f, 0.75f},
+                  Float4{0.5f, 1, 1, 0.5f}, Float4{0, 1, 1, 0.6f});
+constexpr auto _translate_zx =
+    make_box_mesh({0.25, -0.01f, 0.25}, {0.75f, 0.01f, 0.75f},
+                  Float4{1, 0.5f, 1, 0.5f}, Float4{1, 0, 1, 0.6f});
+constexpr auto _translate_xy =
+    make_box_mesh({0.25, 0.25, -0.01f}, {0.75f, 0.75f, 0.01f},
+                  Float4{1, 1, 0.5f, 0.5f}, Float4{1, 1, 0, 0.6f});
+constexpr auto _translate_xyz =
+    make_box_mesh({-0.05f, -0.05f, -0.05f}, {0.05f, 0.05f, 0.05f},
+                  Float4{0.9f, 0.9f, 0.9f, 0.25f}, Float4{1, 1, 1, 0.35f});
+
+// the arrows default to LOD_SLICES[1] = 16 slices
+constexpr std::pair<TranslationGizmo::GizmoComponentType, LodMeshView>
+    _gizmo_components[] = {
+        {TranslationGizmo::GizmoComponentType::TranslationX,
+         _translate_x.view(1)},
+        {TranslationGizmo::GizmoComponentType::TranslationY,
+         _translate_y.view(1)},
+        {TranslationGizmo::GizmoComponentType::TranslationZ,
+         _translate_z.view(1)},
+        {TranslationGizmo::GizmoComponentType::TranslationYZ,
+         LodMeshView::fixed(_translate_yz.view())},
+        {TranslationGizmo::GizmoComponentType::TranslationZX,
+         LodMeshView::fixed(_translate_zx.view())},
+        {TranslationGizmo::GizmoComponentType::TranslationXY,
+         LodMeshView::fixed(_translate_xy.view())},
+        {TranslationGizmo::GizmoComponentType::TranslationView,
+         LodMeshView::fixed(_translate_xyz.view())},
 };
 
-void position_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<TranslationGizmo::GizmoComponentType> active_component) {
+// the arrows as solids for PickMode::Analytic, from arrow_points. the plane
+// and view handles are boxes, which their meshes are exactly
+constexpr std::pair<TranslationGizmo::GizmoComponentType, AnalyticArrow>
+    _analytic_components[] = {
+        {TranslationGizmo::GizmoComponentType::TranslationX,
+         {{1, 0, 0}, 0.25f, 1, 0.05f, 1.2f, 0.1f}},
+        {TranslationGizmo::GizmoComponentType::TranslationY,
+         {{0, 1, 0}, 0.25f, 1, 0.05f, 1.2f, 0.1f}},
+        {TranslationGizmo::GizmoComponentType::TranslationZ,
+         {{0, 0, 1}, 0.25f, 1, 0.05f, 1.2f, 0.1f}},
+};
+
+static const AnalyticArrow *
+analytic_arrow(TranslationGizmo::GizmoComponentType component) {
+  for (auto &[c, arrow] : _analytic_components) {
+    if (c == component) {
+      return &arrow;
+    }
+  }
+  return nullptr;
+}
+
+// union of the component bounds. rejects a missing ray before any mesh test
+constexpr AABB _gizmo_bounds = [] {
+  AABB bounds;
   for (auto &[component, mesh] : _gizmo_components) {
+    bounds.extend(mesh.bounds());
+  }
+  return bounds;
+}();
+
+void position_mesh(
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<TranslationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
     auto color = (component == active_component) ? mesh.base_color
                                                  : mesh.highlight_color;
     mesh.add_triangles(add_world_triangle, modelMatrix, color);
   }
 }
 
+void position_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<TranslationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit) {
+  for (auto &[component, lod] : _gizmo_components) {
+    auto &mesh = lod.select(pixels_per_unit);
+    mesh.add_mesh(add_mesh, modelMatrix,
+                  (component == active_component) ? mesh.base_color
+                                                  : mesh.highlight_color);
+  }
+}
+
+const AABB &position_bounds() { return _gizmo_bounds; }
+
 std::tuple<std::optional<TranslationGizmo::GizmoComponentType>, float>
-position_intersect(const Ray &ray) {
+position_intersect(const Ray &ray, float pixels_per_unit,
+                   PickMode pick_mode) {
   float best_t = std::numeric_limits<float>::infinity();
+  if (!ray.intersect_aabb(_gizmo_bounds)) {
+    return {std::nullopt, best_t};
+  }
   std::optional<TranslationGizmo::GizmoComponentType> updated_state = {};
-  for (auto &[compoennt, mesh] : _gizmo_components) {
-    float t = mesh.intersect(ray);
+  for (auto &[compoennt, lod] : _gizmo_components) {
+    auto arrow =
+        pick_mode == PickMode::Analytic ? analytic_arrow(compoennt) : nullptr;
+    float t = arrow ? arrow->intersect(ray)
+                    : lod.select(pixels_per_unit).intersect(ray);
     if (t < best_t) {
       updated_state = compoennt;
       best_t = t;
@@ -85,90 +142,98 @@ static Float3 click_offset(const RayState &ray_state) {
   return click_offset;
 }
 
-static std::optional<Float3> plane_drag(const Float3 &plane_normal,
-                                        const FrameState &frame,
-                                        const RayState &drag,
-                                        const Transform &src) {
-  auto plane =
-      Plane::from_normal_and_position(plane_normal, drag.transform.position);
-  auto t = frame.ray.intersect_plane(plane);
-  if (!t) {
-    return {};
-  }
-
-  return frame.ray.point(*t) - click_offset(drag);
+// a plane that contains the axis and is oriented to face the camera
+static Float3 axis_plane_normal(const Float3 &axis, const FrameState &frame,
+                                const Transform &src) {
+  auto plane_tangent = Float3::cross(axis, src.position - frame.ray.origin);
+  return Float3::cross(axis, plane_tangent);
 }
 
-static std::optional<Float3> axis_drag(const Float3 &axis,
-                                       const FrameState &active_state,
-                                       const RayState &drag,
-                                       const Transform &src) {
-  // First apply a plane translation dragger with a plane that contains the
-  // desired axis and is oriented to face the camera
-  auto plane_tangent =
-      Float3::cross(axis, src.position - active_state.ray.origin);
-  auto plane_normal = Float3::cross(axis, plane_tangent);
-  auto plane =
-      Plane::from_normal_and_position(plane_normal, drag.transform.position);
-  auto t = active_state.ray.intersect_plane(plane);
-  if (!t) {
-    return {};
-  }
-  auto dst = active_state.ray.point(*t);
+void position_drag_begin(TranslationGizmo::GizmoComponentType active_component,
+                         const FrameState &frame, RayState &drag) {
+  auto &src = drag.transform;
+  auto &cache = drag.cache;
+  cache.click = click_offset(drag);
 
-  // Constrain object motion to be along the desired axis
-  return drag.transform.position +
-         axis.scale(Float3::dot(dst - drag.transform.position, axis)) -
-         click_offset(drag);
-}
+  Float3 normal;
+  switch (active_component) {
+  case TranslationGizmo::GizmoComponentType::TranslationX:
+    cache.axis = drag.local_toggle ? src.orientation.xdir() : Float3{1, 0, 0};
+    normal = axis_plane_normal(cache.axis, frame, src);
+    break;
 
-std::optional<Float3>
-position_drag(TranslationGizmo::GizmoComponentType active_component,
-              const FrameState &frame, const RayState &drag,
-              const Transform &src) {
+  case TranslationGizmo::GizmoComponentType::TranslationY:
+    cache.axis = drag.local_toggle ? src.orientation.ydir() : Float3{0, 1, 0};
+    normal = axis_plane_normal(cache.axis, frame, src);
+    break;
 
-  switch (active_component) {
-  case TranslationGizmo::GizmoComponentType::TranslationX: {
-    auto axis = (drag.local_toggle) ? src.orientation.xdir() : Float3{1, 0, 0};
-    return axis_drag(axis, frame, drag, src);
-  }
+  case TranslationGizmo::GizmoComponentType::TranslationZ:
+    cache.axis = drag.local_toggle ? src.orientation.zdir() : Float3{0, 0, 1};
+    normal = axis_plane_normal(cache.axis, frame, src);
+    break;
 
-  case TranslationGizmo::GizmoComponentType::TranslationY: {
-    auto axis = (drag.local_toggle) ? src.orientation.ydir() : Float3{0, 1, 0};
-    return axis_drag(axis, frame, drag, src);
-  }
+  case TranslationGizmo::GizmoComponentType::TranslationXY:
+    normal = drag.local_toggle ? src.orientation.zdir() : Float3{0, 0, 1};
+    break;
 
-  case TranslationGizmo::GizmoComponentType::TranslationZ: {
-    auto axis = (drag.local_toggle) ? src.orientation.zdir() : Float3{0, 0, 1};
-    return axis_drag(axis, frame, drag, src);
-  }
+  case TranslationGizmo::GizmoComponentType::TranslationYZ:
+    normal = drag.local_toggle ? src.orientation.xdir() : Float3{1, 0, 0};
+    break;
 
-  case TranslationGizmo::GizmoComponentType::TranslationXY: {
-    auto normal =
-        (drag.local_toggle) ? src.orientation.zdir() : Float3{0, 0, 1};
-    return plane_drag(normal, frame, drag, src);
-  }
+  case TranslationGizmo::GizmoComponentType::TranslationZX:
+    normal = drag.local_toggle ? src.orientation.ydir() : Float3{0, 1, 0};
+    break;
+
+  case TranslationGizmo::GizmoComponentType::TranslationView:
+    normal = -frame.cam_orientation.zdir();
+    break;
 
-  case TranslationGizmo::GizmoComponentType::TranslationYZ: {
-    auto normal =
-        (drag.local_toggle) ? src.orientation.xdir() : Float3{1, 0, 0};
-    return plane_drag(normal, frame, drag, src);
+  default:
+    assert(false);
+    throw std::runtime_error("unknown translation");
   }
+  cache.plane = Plane::from_normal_and_position(normal, src.position);
+}
 
-  case TranslationGizmo::GizmoComponentType::TranslationZX: {
-    auto normal =
-        (drag.local_toggle) ? src.orientation.ydir() : Float3{0, 1, 0};
-    return plane_drag(normal, frame, drag, src);
+std::optional<Float3>
+position_drag(TranslationGizmo::GizmoComponentType active_component,
+              const FrameState &frame, const RayState &drag,
+              const Transform &src) {
+  auto &cache = drag.cache;
+  auto t = frame.ray.intersect_plane(cache.plane);
+  if (!t) {
+    return {};
   }
+  auto dst = frame.ray.point(*t);
 
-  case TranslationGizmo::GizmoComponentType::TranslationView: {
-    auto normal = -frame.cam_orientation.zdir();
-    return plane_drag(normal, frame, drag, src);
+  const float step = frame.snap_translation;
+  switch (active_component) {
+  case TranslationGizmo::GizmoComponentType::TranslationX:
+  case TranslationGizmo::GizmoComponentType::TranslationY:
+  case TranslationGizmo::GizmoComponentType::TranslationZ: {
+    // Constrain object motion to be along the desired axis
+    auto &start = drag.transform.position;
+    auto position =
+        start + cache.axis.scale(Float3::dot(dst - start, cache.axis)) -
+        cache.click;
+    if (step > 0) {
+      // only the coordinate along the axis
+      float along = Float3::dot(position, cache.axis);
+      position = position + cache.axis.scale(snap(along, step) - along);
+    }
+    return position;
   }
 
-  default:
-    assert(false);
-    throw std::runtime_error("unknown translation");
+  default: {
+    auto position = dst - cache.click;
+    if (step > 0) {
+      // the grid point, moved back onto the plane
+      auto snapped = snap(position, step);
+      auto &n = cache.plane.normal;
+      position = snapped - n.scale(Float3::dot(snapped - position, n));
+    }
+    return position;
+  }
   }
 }
 
@@ -4,11 +4,25 @@
 namespace tinygizmo {
 
 void position_mesh(
-    const Float4x4 &modelMatrix, const AddTriangleFunc &add_world_triangle,
-    std::optional<TranslationGizmo::GizmoComponentType> active_component);
+    const Float4x4 &modelMatrix, const AddTriangleRef &add_world_triangle,
+    std::optional<TranslationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
+
+void position_mesh(
+    const Float4x4 &modelMatrix, const AddMeshRef &add_mesh,
+    std::optional<TranslationGizmo::GizmoComponentType> active_component,
+    float pixels_per_unit = 0);
 
 std::tuple<std::optional<TranslationGizmo::GizmoComponentType>, float>
-position_intersect(const Ray &ray);
+position_intersect(const Ray &ray, float pixels_per_unit = 0,
+                   PickMode pick_mode = PickMode::Mesh);
+
+// local space bounds of all components
+const AABB &position_bounds();
+
+// fills drag.cache for the component that intersect picked
+void position_drag_begin(TranslationGizmo::GizmoComponentType active_component,
+                         const FrameState &frame, RayState &drag);
 
 std::optional<Float3>
 position_drag(TranslationGizmo::GizmoComponentType active_component,
@@ -0,0 +1,103 @@
+#pragma once
+#include "tinygizmo_alg.h"
+#include <array>
+#include <numeric>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace tinygizmo {
+
+// Finds coincident vertices. Returns for each vertex the index of the vertex
+// it is welded to (itself if it is the first of its group).
+//
+// Same result as the pairwise loop
+//   for i: if i is not welded yet: weld every j > i with
+//          (p[j] - p[i]).length2() < epsilon2 to i
+// but the candidates for j come from a hashed grid with cells of
+// sqrt(epsilon2), so only the 27 cells around p[i] are visited. epsilon2 <= 0
+// welds only equal positions.
+inline std::vector<uint32_t> weld_vertices(std::span<const Vertex> vertices,
+                                           double epsilon2) {
+  std::vector<uint32_t> welded(vertices.size(), UINT32_MAX);
+  if (vertices.empty()) {
+    return welded;
+  }
+
+  const bool exact = !(epsilon2 > 0);
+  // a little larger than the radius, so that a neighbour is never more than
+  // one cell away on each axis. any larger cell works too
+  float cell = exact ? 1.0f : static_cast<float>(std::sqrt(epsilon2) * 1.01);
+  if (!(cell > 0)) {
+    cell = 1;
+  }
+  auto cell_of = [cell](const Float3 &p) {
+    return std::array<int32_t, 3>{
+        grid_cell(p.x, cell),
+        grid_cell(p.y, cell),
+        grid_cell(p.z, cell),
+    };
+  };
+  // 21 bits per axis. cells that alias share a bucket, which only costs a
+  // few extra distance tests
+  auto key_of = [](int32_t x, int32_t y, int32_t z) {
+    return (static_cast<uint64_t>(x & 0x1fffff) << 42) |
+           (static_cast<uint64_t>(y & 0x1fffff) << 21) |
+           static_cast<uint64_t>(z & 0x1fffff);
+  };
+
+  // bucket = [begin, end) of order, sorted by cell
+  std::vector<uint64_t> keys(vertices.size());
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    auto c = cell_of(vertices[i].position);
+    keys[i] = key_of(c[0], c[1], c[2]);
+  }
+  std::vector<uint32_t> order(vertices.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&keys](uint32_t a, uint32_t b) {
+    return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+  });
+  std::unordered_map<uint64_t, std::pair<uint32_t, uint32_t>> buckets;
+  buckets.reserve(vertices.size());
+  for (uint32_t begin = 0; begin < order.size();) {
+    auto end = begin + 1;
+    while (end < order.size() && keys[order[end]] == keys[order[begin]]) {
+      ++end;
+    }
+    buckets.emplace(keys[order[begin]], std::make_pair(begin, end));
+    begin = end;
+  }
+
+  for (uint32_t i = 0; i < vertices.size(); ++i) {
+    if (welded[i] != UINT32_MAX) {
+      continue;
+    }
+    welded[i] = i;
+    auto v0 = vertices[i].position;
+    auto c = cell_of(v0);
+    for (int32_t dx = -1; dx <= 1; ++dx) {
+      for (int32_t dy = -1; dy <= 1; ++dy) {
+        for (int32_t dz = -1; dz <= 1; ++dz) {
+          auto found = buckets.find(key_of(c[0] + dx, c[1] + dy, c[2] + dz));
+          if (found == buckets.end()) {
+            continue;
+          }
+          auto [begin, end] = found->second;
+          // each bucket is sorted by index. only j > i
+          auto first = std::upper_bound(order.begin() + begin,
+                                        order.begin() + end, i);
+          for (auto it = first; it != order.begin() + end; ++it) {
+            auto j = *it;
+            auto d2 = (vertices[j].position - v0).length2();
+            if (d2 < epsilon2 || (exact && d2 == 0)) {
+              welded[j] = i;
+            }
+          }
+        }
+      }
+    }
+  }
+  return welded;
+}
+
+} // namespace tinygizmo